@@ -17,4 +17,22 @@ cp /public/js/toastify.js /output/js
 cp /public/js/webaudio-tinysynth.js /output/js
 cp -r /public/css /output
 cp -r /public/img /output
-cp -r /public/tetris.mid /output
\ No newline at end of file
+cp -r /public/tetris.mid /output
+
+# gzip copies that get_handler sends to browsers accepting them, kept only
+# where they are smaller. SPIFFS names are at most 31 bytes, a file whose
+# .gz name would be longer is sent uncompressed.
+find "/output" -type f \( -name '*.html' -o -name '*.js' -o -name '*.css' -o -name '*.svg' -o -name '*.mid' \) | while read -r f; do
+  name="/www${f#/output}.gz"
+  if [ ${#name} -gt 31 ]; then
+    echo "Not compressing $name: name too long for SPIFFS"
+    continue
+  fi
+  gzip -9 -n -c "$f" > "$f.gz"
+  if [ $(wc -c < "$f.gz") -ge $(wc -c < "$f") ]; then
+    rm "$f.gz"
+  fi
+done
+
+# Content hashes for the ETags get_handler sends, read once at start.
+(cd "/output" && find . -type f ! -name etags.txt | LC_ALL=C sort | xargs cksum > etags.txt)
@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "badge/badge.h"
+#include "host_shim.h"
+
+/*
+ * Cost of getting one marauder beacon ready to send: the way the TX loop
+ * used to do it (six esp_random() calls and the whole frame rebuilt with a
+ * timestamp read) against patching the prebuilt template.
+ */
+
+static const char *ssids[MARAUDER_SSID_COUNT] = {
+    "FREE PALESTINE", "FREE PALESTINE ", " FREE PALESTINE", "FREE PALESTINE  ", "  FREE PALESTINE",
+    "FREE PALESTINE   ", "   FREE PALESTINE", "FREE PALESTINE    ", "    FREE PALESTINE", "FREE PALESTINE     ",
+};
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* The previous create_beacon_frame(), fixed elements written as one block. */
+static int legacy_beacon(uint8_t *frame, const uint8_t *mac, const char *ssid, uint8_t channel)
+{
+    static const uint8_t head[] = { 0x80, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    static const uint8_t rates[] = { 0x01, 8, 0x82, 0x84, 0x8b, 0x96, 0x24, 0x30, 0x48, 0x6c, 0x03, 0x01 };
+    static const uint8_t rsn[] = { 0x30, 0x18, 0x01, 0x00, 0x00, 0x0f, 0xac, 0x02, 0x02, 0x00, 0x00, 0x0f, 0xac,
+                                   0x04, 0x00, 0x0f, 0xac, 0x04, 0x01, 0x00, 0x00, 0x0f, 0xac, 0x02 };
+    int offset = 0;
+    for (size_t i = 0; i < sizeof(head); i++) {
+        frame[offset++] = head[i];
+    }
+    memcpy(&frame[offset], mac, 6);
+    offset += 6;
+    memcpy(&frame[offset], mac, 6);
+    offset += 6;
+    frame[offset++] = 0x00;
+    frame[offset++] = 0x00;
+    uint64_t timestamp = esp_timer_get_time() / 1000;
+    for (int i = 0; i < 8; i++) {
+        frame[offset++] = (timestamp >> (i * 8)) & 0xFF;
+    }
+    frame[offset++] = 0x64;
+    frame[offset++] = 0x00;
+    frame[offset++] = 0x21;
+    frame[offset++] = 0x00;
+    frame[offset++] = 0x00;
+    frame[offset++] = strlen(ssid);
+    memcpy(&frame[offset], ssid, strlen(ssid));
+    offset += strlen(ssid);
+    for (size_t i = 0; i < sizeof(rates); i++) {
+        frame[offset++] = rates[i];
+    }
+    frame[offset++] = channel;
+    for (size_t i = 0; i < sizeof(rsn); i++) {
+        frame[offset++] = rsn[i];
+    }
+    return offset;
+}
+
+int bench_beacon(int argc, char **argv)
+{
+    int rounds = 100000;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:")) != -1) {
+        switch (opt) {
+            case 'r': rounds = atoi(optarg); break;
+            default: return 2;
+        }
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+    wifi_marauder_build_frames(6);
+
+    /* The template has to come out as the old builder's frame for the same
+     * address, apart from the sequence number and timestamp. */
+    int mismatches = 0;
+    for (int i = 0; i < MARAUDER_SSID_COUNT; i++) {
+        const uint8_t *frame;
+        uint8_t legacy[256];
+        int len = wifi_marauder_frame(i, 0, &frame);
+        int legacy_len = legacy_beacon(legacy, &frame[BEACON_SA_OFFSET], ssids[i], 6);
+        if (len != legacy_len || memcmp(frame, legacy, BEACON_SEQ_OFFSET) ||
+            memcmp(&frame[BEACON_TIMESTAMP_OFFSET + 8], &legacy[BEACON_TIMESTAMP_OFFSET + 8],
+                   len - BEACON_TIMESTAMP_OFFSET - 8)) {
+            printf("SSID %d: template differs from the rebuilt frame\n", i);
+            mismatches++;
+        }
+    }
+
+    volatile uint8_t sink = 0;
+    double start = now_s();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < MARAUDER_SSID_COUNT; i++) {
+            uint8_t frame[256];
+            uint8_t mac[6];
+            for (int j = 0; j < 6; j++) {
+                mac[j] = esp_random() % 256;
+            }
+            mac[0] &= 0xFC;
+            int len = legacy_beacon(frame, mac, ssids[i], 6);
+            sink ^= frame[len - 1];
+        }
+    }
+    double legacy_s = now_s() - start;
+
+    start = now_s();
+    for (int r = 0; r < rounds; r++) {
+        int64_t tsf_us = esp_timer_get_time(); // once per burst, as the TX loop does
+        for (int i = 0; i < MARAUDER_SSID_COUNT; i++) {
+            const uint8_t *frame;
+            int len = wifi_marauder_frame(i, tsf_us, &frame);
+            sink ^= frame[len - 1];
+        }
+    }
+    double template_s = now_s() - start;
+
+    /* Distinct addresses among the last burst's worth of frames and more. */
+    uint8_t seen[1024][6];
+    int distinct = 0;
+    for (int n = 0; n < 1024; n++) {
+        const uint8_t *frame;
+        wifi_marauder_frame(n % MARAUDER_SSID_COUNT, 0, &frame);
+        memcpy(seen[n], &frame[BEACON_SA_OFFSET], 6);
+        int dup = 0;
+        for (int k = 0; k < n && !dup; k++) {
+            dup = !memcmp(seen[k], seen[n], 6);
+        }
+        distinct += !dup;
+    }
+
+    uint64_t frames = (uint64_t)rounds * MARAUDER_SSID_COUNT;
+    printf("frames=%llu rounds=%d\n", (unsigned long long)frames, rounds);
+    printf("rebuild: ns/frame=%.1f stack_buffer=256B\n", legacy_s * 1e9 / frames);
+    printf("template: ns/frame=%.1f stack_buffer=0B templates=%zuB\n", template_s * 1e9 / frames,
+           (size_t)MARAUDER_SSID_COUNT * BEACON_MAX_LEN);
+    printf("distinct addresses=%d/1024 mismatches=%d\n", distinct, mismatches);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "badge/badge.h"
+#include "hci_corpus.h"
+#include "host_shim.h"
+
+/*
+ * Throughput of the advertising report path: every packet of the corpus
+ * goes through bt_process_packet(), which is what bt_task runs for each
+ * packet it takes off adv_queue.
+ */
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int bench_adv(int argc, char **argv)
+{
+    const char *path = NULL;
+    int rounds = 200;
+    int badges = 24;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:r:n:")) != -1) {
+        switch (opt) {
+            case 'f': path = optarg; break;
+            case 'r': rounds = atoi(optarg); break;
+            case 'n': badges = atoi(optarg); break;
+            default: return 2;
+        }
+    }
+
+    hci_corpus_t corpus = { 0 };
+    if (path) {
+        if (hci_corpus_load(&corpus, path) < 0) {
+            return 1;
+        }
+    } else {
+        hci_corpus_synthesize(&corpus, 4096, badges);
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    host_heap_stats_t before, after;
+    uint64_t reports = 0;
+    host_heap_stats_get(&before);
+    double start = now_s();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < corpus.count; i++) {
+            reports += bt_process_packet(corpus.packets[i].data, corpus.packets[i].len);
+        }
+    }
+    double elapsed = now_s() - start;
+    host_heap_stats_get(&after);
+
+    uint64_t heap_ops = (after.mallocs - before.mallocs) + (after.frees - before.frees);
+    printf("packets=%zu rounds=%d reports=%llu\n", corpus.count, rounds, (unsigned long long)reports);
+    printf("reports/sec=%.0f ns/report=%.1f heap_ops/report=%.3f\n",
+           reports / elapsed, elapsed * 1e9 / (reports ? reports : 1),
+           (double)heap_ops / (reports ? reports : 1));
+
+    hci_corpus_free(&corpus);
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "badge/badge.h"
+
+/*
+ * The JSON writer the REST replies use, checked against known answers:
+ * escaping, fixed-point numbers, nesting, and output split over a buffer
+ * smaller than the document coming out the same as in one piece.
+ */
+
+typedef struct {
+    char out[16384];
+    size_t len;
+} sink_t;
+
+static esp_err_t sink_flush(void *ctx, const void *data, size_t len)
+{
+    sink_t *sink = ctx;
+    if (sink->len + len >= sizeof(sink->out)) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(sink->out + sink->len, data, len);
+    sink->len += len;
+    sink->out[sink->len] = '\0';
+    return ESP_OK;
+}
+
+static int check(const char *name, sink_t *sink, const char *expected)
+{
+    if (strcmp(sink->out, expected)) {
+        printf("%s: got %s\n  expected %s\n", name, sink->out, expected);
+        return 1;
+    }
+    return 0;
+}
+
+static int known_answers(void)
+{
+    int failed = 0;
+    char buf[JSON_CHUNK_LEN];
+    sink_t *sink = calloc(1, sizeof(*sink));
+    json_writer_t w;
+
+    json_init(&w, buf, sizeof(buf), sink_flush, sink);
+    json_object_begin(&w, NULL);
+    json_object_end(&w);
+    json_finish(&w);
+    failed += check("empty", sink, "{}");
+
+    sink->len = 0;
+    json_init(&w, buf, sizeof(buf), sink_flush, sink);
+    json_object_begin(&w, NULL);
+    json_string(&w, "name", "a\"b\\c\n\x01");
+    json_int(&w, "min", INT64_MIN);
+    json_int(&w, "zero", 0);
+    json_fixed(&w, "duty", 125, 1);
+    json_fixed(&w, "ma", 45060, 3);
+    json_fixed(&w, "neg", -5, 2);
+    json_fixed(&w, "whole", 7000, 3);
+    json_array_begin(&w, "list");
+    json_bool(&w, NULL, true);
+    json_array_begin(&w, NULL);
+    json_array_end(&w);
+    json_object_begin(&w, NULL);
+    json_object_end(&w);
+    json_array_end(&w);
+    json_object_end(&w);
+    json_finish(&w);
+    failed += check("values", sink,
+                    "{\"name\":\"a\\\"b\\\\c\\n\\u0001\",\"min\":-9223372036854775808,\"zero\":0,\"duty\":12.5,"
+                    "\"ma\":45.06,\"neg\":-0.05,\"whole\":7,\"list\":[true,[],{}]}");
+
+    /* Chunked output is the same as one piece. */
+    char small[7];
+    sink->len = 0;
+    json_init(&w, small, sizeof(small), sink_flush, sink);
+    json_object_begin(&w, NULL);
+    json_string(&w, "wifi", "badge-ap");
+    json_int(&w, "n", 123456789);
+    json_object_end(&w);
+    json_finish(&w);
+    failed += check("chunked", sink, "{\"wifi\":\"badge-ap\",\"n\":123456789}");
+    free(sink);
+    return failed;
+}
+
+int check_json(int argc, char **argv)
+{
+    int failed = known_answers();
+    printf("failed=%d\n", failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "badge/badge.h"
+#include "hci_corpus.h"
+#include "host_shim.h"
+
+/*
+ * Replays a capture (see bt_capture_start()) into the booted firmware, as
+ * if the controller delivered it, and fuzzes the advertising parser with
+ * mutated copies of a capture.
+ */
+
+/* AD data that once hung a parser, run before the random mutations. */
+static const uint8_t fuzz_seeds[][31] = {
+    { 0xFF, 0x01 },                 // length wraps an 8 bit index back onto itself
+    { 0x1F, 0x09, '[' },            // record runs past the end of the data
+    { 0x02, 0x01, 0x06, 0xFE, 0x09, '[' },
+};
+
+void app_main();
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/* Packets bt_task is done with: parsed, or never queued. */
+static uint32_t packets_settled(void)
+{
+    bt_pkt_pool_stats_t stats;
+    bt_get_pkt_pool_stats(&stats);
+    return stats.processed + stats.rejected + stats.dropped + stats.oversized;
+}
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+int replay(int argc, char **argv)
+{
+    const char *path = NULL;
+    int rate = 0;
+    int loops = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:r:l:")) != -1) {
+        switch (opt) {
+            case 'f': path = optarg; break;
+            case 'r': rate = atoi(optarg); break;
+            case 'l': loops = atoi(optarg); break;
+            default: return 2;
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "replay: -f capture file is required\n");
+        return 2;
+    }
+
+    hci_corpus_t corpus = { 0 };
+    if (hci_corpus_load(&corpus, path) < 0 || corpus.count == 0) {
+        return 1;
+    }
+
+    app_main();
+    /* Let bt_task finish the controller setup. */
+    vTaskDelay(pdMS_TO_TICKS(200));
+
+    size_t total = corpus.count * loops;
+    int64_t *latency = rate ? malloc(total * sizeof(int64_t)) : NULL;
+    uint32_t base = packets_settled();
+    size_t n = 0;
+    int64_t start = now_us();
+
+    for (int l = 0; l < loops; l++) {
+        for (size_t i = 0; i < corpus.count; i++, n++) {
+            if (!rate) {
+                /* Flat out, but never more in flight than the packet pool
+                 * holds, so this measures bt_task and not drops. */
+                while (n - (packets_settled() - base) >= BT_PKT_POOL_SLOTS) {
+                    usleep(1);
+                }
+                host_vhci_deliver(corpus.packets[i].data, corpus.packets[i].len);
+                continue;
+            }
+            int64_t t0 = now_us();
+            host_vhci_deliver(corpus.packets[i].data, corpus.packets[i].len);
+            /* Paced: wait for bt_task to be done with it to get its latency. */
+            while (packets_settled() - base < n + 1) {
+                usleep(10);
+            }
+            latency[n] = now_us() - t0;
+            int64_t next = start + (int64_t)(n + 1) * 1000000 / rate;
+            int64_t wait = next - now_us();
+            if (wait > 0) {
+                usleep(wait);
+            }
+        }
+    }
+    while (packets_settled() - base < total) {
+        usleep(100);
+    }
+    int64_t elapsed = now_us() - start;
+
+    bt_pkt_pool_stats_t stats;
+    bt_get_pkt_pool_stats(&stats);
+    printf("packets=%zu elapsed=%.3fs rate=%.0f/s\n", total, elapsed / 1e6, total * 1e6 / elapsed);
+    printf("processed=%u rejected=%u dropped=%u oversized=%u high_water=%u/%d nearby=%u\n",
+           stats.processed, stats.rejected, stats.dropped, stats.oversized, stats.high_water,
+           BT_PKT_POOL_SLOTS, count_ble_nodes());
+    if (latency) {
+        int64_t sum = 0;
+        for (size_t i = 0; i < total; i++) {
+            sum += latency[i];
+        }
+        qsort(latency, total, sizeof(int64_t), cmp_i64);
+        printf("latency: avg=%lldus p50=%lldus p99=%lldus max=%lldus\n", (long long)(sum / total),
+               (long long)latency[total / 2], (long long)latency[total * 99 / 100],
+               (long long)latency[total - 1]);
+        free(latency);
+    }
+    hci_corpus_free(&corpus);
+    return 0;
+}
+
+/* Meant to run under valgrind or an -fsanitize=address build. */
+int fuzz_adv(int argc, char **argv)
+{
+    const char *path = NULL;
+    long iterations = 1000000;
+    unsigned seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:i:s:")) != -1) {
+        switch (opt) {
+            case 'f': path = optarg; break;
+            case 'i': iterations = atol(optarg); break;
+            case 's': seed = atoi(optarg); break;
+            default: return 2;
+        }
+    }
+
+    hci_corpus_t corpus = { 0 };
+    if (path) {
+        if (hci_corpus_load(&corpus, path) < 0) {
+            return 1;
+        }
+    } else {
+        hci_corpus_synthesize(&corpus, 1024, 24);
+    }
+    if (corpus.count == 0) {
+        return 1;
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+    srand(seed);
+
+    uint8_t buf[BT_PKT_SLOT_SIZE];
+    long reports = 0;
+    static const uint8_t seed_addr[6] = { 0xFA, 0x22, 0x33, 0x44, 0x55, 0x66 };
+    for (size_t i = 0; i < sizeof(fuzz_seeds) / sizeof(fuzz_seeds[0]); i++) {
+        uint16_t len = host_vhci_make_adv_report(buf, sizeof(buf), seed_addr, -50, fuzz_seeds[i],
+                                                 sizeof(fuzz_seeds[i]));
+        bt_adv_event_wanted(buf, len);
+        bt_process_packet(buf, len);
+    }
+    for (long it = 0; it < iterations; it++) {
+        const hci_packet_t *pkt = &corpus.packets[rand() % corpus.count];
+        uint16_t len = pkt->len < sizeof(buf) ? pkt->len : sizeof(buf);
+        memcpy(buf, pkt->data, len);
+
+        int flips = 1 + rand() % 4;
+        for (int f = 0; f < flips; f++) {
+            /* Keep the event header so the parser is reached. */
+            int pos = 4 + rand() % (len > 4 ? len - 4 : 1);
+            if (pos < len) {
+                buf[pos] = rand() % 3 ? buf[pos] ^ (1 << (rand() % 8)) : rand();
+            }
+        }
+        if (rand() % 8 == 0) {
+            len = 4 + rand() % (len - 3);
+        }
+        /* Copy into an exact-size block so overreads hit the redzone. */
+        uint8_t *exact = malloc(len);
+        memcpy(exact, buf, len);
+        bt_adv_event_wanted(exact, len);
+        int num = bt_process_packet(exact, len);
+        free(exact);
+        if (num > 0) {
+            reports += num;
+        }
+    }
+    printf("iterations=%ld reports=%ld nearby=%u\n", iterations, reports, count_ble_nodes());
+    hci_corpus_free(&corpus);
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "badge/badge.h"
+#include "hci_corpus.h"
+#include "host_shim.h"
+
+/*
+ * Heap calls and latency of each /api/v1/ handler in httpd.c, run through
+ * the in-process esp_http_server with the nearby table full. The response
+ * body is kept by the shim outside the heap counts, so what is left is
+ * the handler's own: the cJSON parse of the request and whatever the
+ * command does. `leaked` is allocations minus frees over all requests.
+ */
+
+typedef struct {
+    const char *name;
+    httpd_method_t method;
+    const char *uri;
+    bool key;           // send {"key": ...}, the rest of the body follows
+    const char *body;
+} api_case_t;
+
+static const api_case_t cases[] = {
+    { "info", HTTP_POST, "/api/v1/info", false, NULL },
+    { "radar", HTTP_POST, "/api/v1/radar", false, NULL },
+    { "marauder", HTTP_POST, "/api/v1/marauder", false, NULL },
+    { "schedule", HTTP_POST, "/api/v1/schedule", false, NULL },
+    { "check_auth", HTTP_POST, "/api/v1/check_authentication", true, "" },
+    { "name", HTTP_POST, "/api/v1/name", true, "" },
+    { "name set", HTTP_POST, "/api/v1/name", true, ", \"name\": \"Saiyan-host\"" },
+    { "wifi", HTTP_POST, "/api/v1/wifi", true, "" },
+    { "capture", HTTP_POST, "/api/v1/capture", true, "" },
+    { "GET /", HTTP_GET, "/", false, NULL },
+};
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Log in with the password from settings.json, returns the session key. */
+static bool login(httpd_handle_t server, char *key, size_t size)
+{
+    char body[96];
+    host_httpd_response_t resp;
+    snprintf(body, sizeof(body), "{\"password\": \"%s\"}", badge_obj.web_login);
+    host_httpd_request(server, HTTP_POST, "/api/v1/login", NULL, body, &resp);
+
+    cJSON *json = resp.status == 200 ? cJSON_Parse(resp.body) : NULL;
+    cJSON *value = cJSON_GetObjectItem(json, "key");
+    bool ok = cJSON_IsString(value);
+    if (ok) {
+        snprintf(key, size, "%s", value->valuestring);
+    }
+    cJSON_Delete(json);
+    host_httpd_response_free(&resp);
+    return ok;
+}
+
+int bench_api(int argc, char **argv)
+{
+    int rounds = 2000;
+    int badges = MAX_NEARBY_NODE * 2;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:n:")) != -1) {
+        switch (opt) {
+            case 'r': rounds = atoi(optarg); break;
+            case 'n': badges = atoi(optarg); break;
+            default: return 2;
+        }
+    }
+    if (rounds <= 0) {
+        return 2;
+    }
+    /* check_session() logs both keys at error level on every request. */
+    esp_log_level_set("*", ESP_LOG_NONE);
+    badge_init();
+    www_init();
+
+    hci_corpus_t corpus = { 0 };
+    hci_corpus_synthesize(&corpus, 4096, badges);
+    for (size_t i = 0; i < corpus.count; i++) {
+        bt_process_packet(corpus.packets[i].data, corpus.packets[i].len);
+    }
+    hci_corpus_free(&corpus);
+
+    /* The same way app_main() gets a server, on the first AP client. */
+    httpd_handle_t server = NULL;
+    connect_handler(&server, IP_EVENT, IP_EVENT_AP_STAIPASSIGNED, NULL);
+    char key[SESSION_KEY_LEN + 1];
+    if (!server || !login(server, key, sizeof(key))) {
+        printf("Could not start the web server and log in\n");
+        return 1;
+    }
+
+    double *lat = malloc(rounds * sizeof(*lat));
+    int failed = 0;
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const api_case_t *t = &cases[c];
+        char body[128];
+        if (t->key) {
+            snprintf(body, sizeof(body), "{\"key\": \"%s\"%s}", key, t->body);
+        }
+
+        host_heap_stats_t heap;
+        size_t bytes = 0;
+        int status = 0;
+        host_heap_stats_reset();
+        for (int r = 0; r < rounds; r++) {
+            host_httpd_response_t resp;
+            double start = now_s();
+            host_httpd_request(server, t->method, t->uri, "Accept-Encoding: gzip\r\n",
+                               t->key ? body : t->body, &resp);
+            lat[r] = now_s() - start;
+            status = resp.status;
+            bytes = resp.body_len;
+            host_httpd_response_free(&resp);
+        }
+        host_heap_stats_get(&heap);
+
+        qsort(lat, rounds, sizeof(*lat), cmp_double);
+        printf("%-10s status=%d p50=%.2fus p99=%.2fus bytes/req=%zu allocs/req=%.2f heap_bytes/req=%.0f leaked=%lld\n",
+               t->name, status, lat[rounds / 2] * 1e6, lat[rounds * 99 / 100] * 1e6, bytes,
+               heap.mallocs / (double)rounds, heap.bytes / (double)rounds,
+               (long long)heap.mallocs - (long long)heap.frees);
+        failed += status != 200;
+    }
+    printf("nearby=%u rounds=%d\n", count_ble_nodes(), rounds);
+
+    free(lat);
+    disconnect_handler(&server, WIFI_EVENT, WIFI_EVENT_AP_STADISCONNECTED, NULL);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "badge/badge.h"
+#include "hci_corpus.h"
+#include "host_shim.h"
+
+/*
+ * Hammers ble_nodes_snapshot() from several reader tasks while the writer
+ * pushes advertising reports through bt_process_packet() as fast as it
+ * can. Every snapshot must be sorted by distance bucket, free of duplicates and made
+ * of nodes whose name matches their address, otherwise a reader saw a
+ * half-published table.
+ */
+
+static atomic_bool stop;
+static atomic_ullong snapshots;
+static atomic_ullong torn;
+
+static bool node_ok(const ble_node_t *node)
+{
+    /* The synthetic corpus names badge n "Saiyan-<0x1000 + n>" with id 1 + n % 7. */
+    int badge = node->addr[4] << 8 | node->addr[5];
+    char name[BADGE_NAME_MAX_SIZE];
+    snprintf(name, sizeof(name), "Saiyan-%04x", 0x1000 + badge);
+    return node->active && node->id == 1 + badge % 7 && !strcmp(node->name, name);
+}
+
+static void reader_task(void *arg)
+{
+    ble_node_t *nodes = malloc(MAX_NEARBY_NODE * sizeof(ble_node_t));
+
+    while (!atomic_load(&stop)) {
+        size_t count = ble_nodes_snapshot(nodes, MAX_NEARBY_NODE);
+        bool ok = count <= MAX_NEARBY_NODE;
+        for (size_t i = 0; ok && i < count; i++) {
+            ok = node_ok(&nodes[i]) && (i == 0 || nodes[i - 1].bucket <= nodes[i].bucket);
+            for (size_t j = 0; ok && j < i; j++) {
+                ok = memcmp(nodes[i].addr, nodes[j].addr, sizeof(nodes[i].addr)) != 0;
+            }
+        }
+        atomic_fetch_add(&snapshots, 1);
+        if (!ok) {
+            atomic_fetch_add(&torn, 1);
+        }
+    }
+    free(nodes);
+    xSemaphoreGive((SemaphoreHandle_t)arg);
+    vTaskDelete(NULL);
+}
+
+int stress_nodes(int argc, char **argv)
+{
+    int seconds = 5;
+    int readers = 4;
+    int badges = MAX_NEARBY_NODE * 2;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:r:n:")) != -1) {
+        switch (opt) {
+            case 't': seconds = atoi(optarg); break;
+            case 'r': readers = atoi(optarg); break;
+            case 'n': badges = atoi(optarg); break;
+            default: return 2;
+        }
+    }
+
+    hci_corpus_t corpus = { 0 };
+    hci_corpus_synthesize(&corpus, 4096, badges);
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(readers, 0);
+    for (int i = 0; i < readers; i++) {
+        xTaskCreate(reader_task, "reader", 4096, done, 5, NULL);
+    }
+
+    uint64_t writes = 0;
+    time_t end = time(NULL) + seconds;
+    while (time(NULL) < end) {
+        for (size_t i = 0; i < corpus.count; i++) {
+            bt_process_packet(corpus.packets[i].data, corpus.packets[i].len);
+        }
+        writes += corpus.count;
+    }
+    atomic_store(&stop, true);
+    for (int i = 0; i < readers; i++) {
+        xSemaphoreTake(done, portMAX_DELAY);
+    }
+
+    printf("packets=%llu snapshots=%llu torn=%llu nearby=%u\n", (unsigned long long)writes,
+           (unsigned long long)atomic_load(&snapshots), (unsigned long long)atomic_load(&torn),
+           count_ble_nodes());
+    hci_corpus_free(&corpus);
+    return atomic_load(&torn) ? 1 : 0;
+}
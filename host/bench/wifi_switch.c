@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "badge/badge.h"
+#include "host_shim.h"
+
+/*
+ * Walks the radio through every pair of states by posting the UI's WiFi
+ * events to the booted firmware, and prints how long wifi_radio_set() took
+ * for each transition. Then fires a burst of alternating requests without
+ * waiting in between, which wifi_task should fold into a few switches.
+ */
+
+void app_main();
+
+#define BURST_REQUESTS 101
+
+static const char *state_names[] = { "off", "AP", "STA", "raw TX" };
+
+/* Every transition between the four states once. */
+static const wifi_radio_state_t walk[] = {
+    WIFI_RADIO_AP, WIFI_RADIO_OFF, WIFI_RADIO_RAW_TX, WIFI_RADIO_OFF, WIFI_RADIO_STA, WIFI_RADIO_OFF,
+    WIFI_RADIO_AP, WIFI_RADIO_STA, WIFI_RADIO_AP, WIFI_RADIO_RAW_TX, WIFI_RADIO_AP, WIFI_RADIO_OFF,
+    WIFI_RADIO_STA, WIFI_RADIO_RAW_TX, WIFI_RADIO_STA, WIFI_RADIO_OFF,
+};
+
+static uint32_t event_for(wifi_radio_state_t from, wifi_radio_state_t to)
+{
+    static const uint32_t start[] = { 0, EVENT_HOTSPOT_START, EVENT_STA_START, EVENT_MARAUDER_START };
+    static const uint32_t stop[] = { 0, EVENT_HOTSPOT_STOP, EVENT_STA_STOP, EVENT_MARAUDER_STOP };
+    return to == WIFI_RADIO_OFF ? stop[from] : start[to];
+}
+
+int wifi_switch(int argc, char **argv)
+{
+    int rounds = 3;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:")) != -1) {
+        switch (opt) {
+            case 'r': rounds = atoi(optarg); break;
+            default: return 2;
+        }
+    }
+
+    app_main();
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    uint64_t total[4][4] = { 0 };
+    uint32_t worst[4][4] = { 0 };
+    uint32_t count[4][4] = { 0 };
+    int failures = 0;
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < SIZEOF(walk); i++) {
+            wifi_radio_state_t from = wifi_radio_get(), to = walk[i];
+            wifi_radio_stats_t before, after;
+            wifi_get_radio_stats(&before);
+
+            uint32_t event = event_for(from, to);
+            wifi_request(event);
+            int waited_ms = 0;
+            do {
+                usleep(1000);
+                wifi_get_radio_stats(&after);
+            } while (after.switches == before.switches && ++waited_ms < 5000);
+
+            if (after.switches == before.switches || wifi_radio_get() != to) {
+                printf("%s -> %s: did not switch\n", state_names[from], state_names[to]);
+                failures++;
+                continue;
+            }
+            total[from][to] += after.last_us;
+            count[from][to]++;
+            if (after.last_us > worst[from][to]) {
+                worst[from][to] = after.last_us;
+            }
+        }
+    }
+
+    printf("%-8s %-8s %10s %10s\n", "from", "to", "avg_ms", "max_ms");
+    for (int from = 0; from < 4; from++) {
+        for (int to = 0; to < 4; to++) {
+            if (count[from][to]) {
+                printf("%-8s %-8s %10.1f %10.1f\n", state_names[from], state_names[to],
+                       total[from][to] / 1000.0 / count[from][to], worst[from][to] / 1000.0);
+            }
+        }
+    }
+    wifi_radio_stats_t stats;
+    wifi_get_radio_stats(&stats);
+    printf("switches=%u avg=%.1fms max=%.1fms failures=%d\n", stats.switches,
+           stats.switches ? stats.total_us / 1000.0 / stats.switches : 0.0, stats.max_us / 1000.0, failures);
+
+    /* Burst: the hotspot toggled BURST_REQUESTS times, ending up on. */
+    wifi_radio_stats_t before, after;
+    if (wifi_radio_get() != WIFI_RADIO_OFF) {
+        wifi_request(event_for(wifi_radio_get(), WIFI_RADIO_OFF));
+    }
+    for (int waited_ms = 0; wifi_radio_get() != WIFI_RADIO_OFF && waited_ms < 5000; waited_ms++) {
+        usleep(1000);
+    }
+    wifi_get_radio_stats(&before);
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < BURST_REQUESTS; i++) {
+        wifi_request(i % 2 ? EVENT_HOTSPOT_STOP : EVENT_HOTSPOT_START);
+    }
+    int64_t queued = esp_timer_get_time();
+    /* radio_state changes as a switch begins, the stats once it is done. */
+    for (int polls = 0; polls < 50000; polls++) {
+        wifi_get_radio_stats(&after);
+        if (after.switches != before.switches && wifi_radio_get() == WIFI_RADIO_AP) {
+            break;
+        }
+        usleep(100);
+    }
+    int64_t settled = esp_timer_get_time();
+    usleep(100 * 1000); // let a switch still under way show up in the count
+    wifi_get_radio_stats(&after);
+    if (wifi_radio_get() != WIFI_RADIO_AP) {
+        printf("burst: did not end in AP\n");
+        failures++;
+    }
+    printf("burst: requests=%u switches=%u posted in %.2fms settled after %.1fms\n",
+           after.requests - before.requests, after.switches - before.switches,
+           (queued - start) / 1000.0, (settled - start) / 1000.0);
+
+    /* A second of beacons, for the marauder counters. */
+    wifi_request(EVENT_MARAUDER_START);
+    usleep(1000 * 1000);
+    wifi_request(EVENT_MARAUDER_STOP);
+    usleep(100 * 1000);
+    wifi_marauder_stats_t tx;
+    wifi_get_marauder_stats(&tx);
+    printf("marauder: frames=%u tx_ok=%u no_mem=%u failed=%u overruns=%u overrun_max=%ums\n", tx.frames,
+           tx.tx_ok, tx.tx_no_mem, tx.tx_failed, tx.overruns, tx.overrun_max_ms);
+    printf("marauder: bursts=%u wakeups=%u late_max=%.2fms idle=%.1f%%\n", tx.bursts, tx.wakeups,
+           tx.late_max_us / 1000.0, tx.busy_ms + tx.idle_ms ? tx.idle_ms * 100.0 / (tx.busy_ms + tx.idle_ms) : 0.0);
+    return failures ? 1 : 0;
+}
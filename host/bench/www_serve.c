@@ -0,0 +1,199 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "badge/badge.h"
+#include "host_shim.h"
+
+/*
+ * Server side cost of a GET for each file of the web UI: open, read in
+ * SCRATCH_BUFSIZE chunks and close on SPIFFS, as get_handler did for every
+ * file, against looking it up in the mapped www partition and sending it in
+ * one go. Both hand the data to the same stand-in for the socket, which
+ * copies it in TCP segments as lwIP does. The browser is taken to accept
+ * gzip.
+ */
+
+#define WWW_PATHS_MAX 64
+#define TCP_MSS 1436
+
+typedef struct {
+    char path[32];
+    bool gzip; // etags.txt lists a .gz copy
+} www_path_t;
+
+static www_path_t paths[WWW_PATHS_MAX];
+static int path_count;
+static char segment[TCP_MSS];
+static volatile uint8_t sink;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void sock_send(const char *buf, size_t len)
+{
+    while (len) {
+        size_t n = len < TCP_MSS ? len : TCP_MSS;
+        memcpy(segment, buf, n);
+        sink ^= segment[n - 1];
+        buf += n;
+        len -= n;
+    }
+}
+
+static int load_paths(void)
+{
+    FILE *fp = fopen(WWW_ETAGS_FILE, "r");
+    if (!fp) {
+        return -1;
+    }
+    char line[80], path[32];
+    unsigned long crc, size;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "%lu %lu .%31s", &crc, &size, path) != 3) {
+            continue;
+        }
+        size_t len = strlen(path);
+        if (len > 3 && !strcmp(path + len - 3, ".gz")) {
+            path[len - 3] = '\0';
+            for (int i = 0; i < path_count; i++) {
+                paths[i].gzip |= !strcmp(paths[i].path, path);
+            }
+        } else if (path_count < WWW_PATHS_MAX) {
+            strcpy(paths[path_count++].path, path);
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+/* The SPIFFS part of get_handler, returns the bytes sent. */
+static size_t serve_spiffs(const www_path_t *p, char *scratch)
+{
+    char filepath[FILE_PATH_MAX];
+    snprintf(filepath, sizeof(filepath), "%s%s%s", BASE_PATH, p->path, p->gzip ? ".gz" : "");
+    int fd = open(filepath, O_RDONLY, 0);
+    if (fd == -1) {
+        return 0;
+    }
+    size_t sent = 0;
+    ssize_t read_bytes;
+    while ((read_bytes = read(fd, scratch, SCRATCH_BUFSIZE)) > 0) {
+        sock_send(scratch, read_bytes);
+        sent += read_bytes;
+    }
+    close(fd);
+    return sent;
+}
+
+static size_t serve_packed(const www_path_t *p)
+{
+    www_file_t file;
+    if (!www_find(p->path, true, &file)) {
+        return 0;
+    }
+    sock_send(file.data, file.length);
+    return file.length;
+}
+
+/* Every file of the blob has to be the one on SPIFFS, byte for byte. */
+static int compare(const www_path_t *p, char *scratch)
+{
+    www_file_t file;
+    if (!www_find(p->path, true, &file) || file.gzip != p->gzip) {
+        printf("%s: missing from the blob\n", p->path);
+        return 1;
+    }
+    char filepath[FILE_PATH_MAX];
+    if (snprintf(filepath, sizeof(filepath), "%s%s%s", BASE_PATH, p->path, p->gzip ? ".gz" : "") >=
+        (int)sizeof(filepath)) {
+        return 1;
+    }
+    FILE *fp = fopen(filepath, "rb");
+    size_t off = 0, n;
+    int diff = !fp;
+    while (fp && !diff && (n = fread(scratch, 1, SCRATCH_BUFSIZE, fp)) > 0) {
+        diff = off + n > file.length || memcmp(scratch, file.data + off, n);
+        off += n;
+    }
+    if (fp) {
+        fclose(fp);
+    }
+    if (diff || off != file.length) {
+        printf("%s: blob differs from SPIFFS\n", p->path);
+        return 1;
+    }
+    return 0;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char *name, double *lat, size_t n, double total_s, size_t bytes,
+                   const host_heap_stats_t *heap)
+{
+    qsort(lat, n, sizeof(*lat), cmp_double);
+    printf("%s: req/s=%.0f p50=%.2fus p99=%.2fus max=%.2fus bytes/req=%zu allocs/req=%.2f\n", name, n / total_s,
+           lat[n / 2] * 1e6, lat[n * 99 / 100] * 1e6, lat[n - 1] * 1e6, bytes / n, heap->mallocs / (double)n);
+}
+
+int bench_www(int argc, char **argv)
+{
+    int rounds = 2000;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:")) != -1) {
+        switch (opt) {
+            case 'r': rounds = atoi(optarg); break;
+            default: return 2;
+        }
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+    spiffs_init();
+    www_init();
+    if (load_paths() || !path_count) {
+        printf("No %s\n", WWW_ETAGS_FILE);
+        return 1;
+    }
+
+    static char scratch[SCRATCH_BUFSIZE];
+    int mismatches = 0;
+    for (int i = 0; i < path_count; i++) {
+        mismatches += compare(&paths[i], scratch);
+    }
+    if (mismatches) {
+        printf("mismatches=%d, pack data/www with www-pack.js\n", mismatches);
+        return 1;
+    }
+
+    size_t n = (size_t)rounds * path_count;
+    double *lat = malloc(n * sizeof(*lat));
+    host_heap_stats_t heap;
+
+    for (int mode = 0; mode < 2; mode++) {
+        size_t bytes = 0;
+        host_heap_stats_reset();
+        double start = now_s();
+        for (size_t k = 0; k < n; k++) {
+            const www_path_t *p = &paths[k % path_count];
+            double t = now_s();
+            bytes += mode ? serve_packed(p) : serve_spiffs(p, scratch);
+            lat[k] = now_s() - t;
+        }
+        double total_s = now_s() - start;
+        host_heap_stats_get(&heap);
+        report(mode ? "packed" : "spiffs", lat, n, total_s, bytes, &heap);
+    }
+    printf("files=%d requests=%zu\n", path_count, n);
+    free(lat);
+    return 0;
+}
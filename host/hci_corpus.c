@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hci_corpus.h"
+#include "host_shim.h"
+
+int hci_corpus_add(hci_corpus_t *corpus, const uint8_t *data, uint16_t len)
+{
+    if (corpus->count == corpus->capacity) {
+        size_t capacity = corpus->capacity ? corpus->capacity * 2 : 256;
+        hci_packet_t *packets = realloc(corpus->packets, capacity * sizeof(*packets));
+        if (!packets) {
+            return -1;
+        }
+        corpus->packets = packets;
+        corpus->capacity = capacity;
+    }
+    uint8_t *copy = malloc(len);
+    if (!copy) {
+        return -1;
+    }
+    memcpy(copy, data, len);
+    corpus->packets[corpus->count].data = copy;
+    corpus->packets[corpus->count].len = len;
+    corpus->count++;
+    return 0;
+}
+
+int hci_corpus_load(hci_corpus_t *corpus, const char *path)
+{
+    uint8_t buf[UINT16_MAX];
+    uint8_t hdr[2];
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+    while (fread(hdr, 1, sizeof(hdr), fp) == sizeof(hdr)) {
+        uint16_t len = hdr[0] | (hdr[1] << 8);
+        if (fread(buf, 1, len, fp) != len) {
+            fprintf(stderr, "%s: truncated record %zu\n", path, corpus->count);
+            break;
+        }
+        if (hci_corpus_add(corpus, buf, len) < 0) {
+            fclose(fp);
+            return -1;
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+void hci_corpus_free(hci_corpus_t *corpus)
+{
+    for (size_t i = 0; i < corpus->count; i++) {
+        free(corpus->packets[i].data);
+    }
+    free(corpus->packets);
+    memset(corpus, 0, sizeof(*corpus));
+}
+
+static uint8_t make_badge_adv(uint8_t *adv, int badge)
+{
+    char name[29];
+    int name_len = snprintf(name, sizeof(name), "[%d] Saiyan-%04x", 1 + badge % 7, 0x1000 + badge);
+    uint8_t len = 0;
+    adv[len++] = 0x02;
+    adv[len++] = 0x01;
+    adv[len++] = 0x06;
+    adv[len++] = name_len + 1;
+    adv[len++] = 0x09;
+    memcpy(&adv[len], name, name_len);
+    return len + name_len;
+}
+
+static uint8_t make_phone_adv(uint8_t *adv, uint32_t seed)
+{
+    /* Flags plus a manufacturer specific blob, like most phones and tags. */
+    uint8_t len = 0;
+    adv[len++] = 0x02;
+    adv[len++] = 0x01;
+    adv[len++] = 0x1a;
+    adv[len++] = 0x18;
+    adv[len++] = 0xff;
+    adv[len++] = 0x4c;
+    adv[len++] = 0x00;
+    for (int i = 0; i < 21; i++) {
+        adv[len++] = (uint8_t)(seed >> (i % 4) * 8) ^ i;
+    }
+    return len;
+}
+
+void hci_corpus_synthesize(hci_corpus_t *corpus, size_t events, int badges)
+{
+    uint8_t pkt[260];
+    uint8_t adv[31];
+
+    for (size_t e = 0; e < events; e++) {
+        uint32_t seed = (uint32_t)(e * 2654435761u);
+        int8_t rssi = -30 - (int8_t)(seed % 60);
+        uint16_t len;
+
+        if (e % 8 == 7) {
+            /* Three reports in one event: badge, phone, badge. */
+            uint8_t data[3][31];
+            uint8_t data_len[3] = {
+                make_badge_adv(data[0], (int)(e % badges)),
+                make_phone_adv(data[1], seed),
+                make_badge_adv(data[2], (int)((e + 1) % badges)),
+            };
+            uint8_t *p = pkt;
+            *p++ = 0x04;
+            *p++ = 0x3e;
+            p++;
+            *p++ = 0x02;
+            *p++ = 3;
+            for (int i = 0; i < 3; i++) *p++ = 0x00;
+            for (int i = 0; i < 3; i++) *p++ = 0x00;
+            int addr_id[3] = { (int)(e % badges), (int)e, (int)((e + 1) % badges) };
+            for (int i = 0; i < 3; i++) {
+                uint8_t addr[6] = {0x10, 0x20, 0x30, 0x40 + (i == 1), (uint8_t)(addr_id[i] >> 8), (uint8_t)addr_id[i]};
+                memcpy(p, addr, 6);
+                p += 6;
+            }
+            for (int i = 0; i < 3; i++) *p++ = data_len[i];
+            for (int i = 0; i < 3; i++) {
+                memcpy(p, data[i], data_len[i]);
+                p += data_len[i];
+            }
+            for (int i = 0; i < 3; i++) *p++ = (uint8_t)(rssi - i);
+            len = p - pkt;
+            pkt[2] = len - 3;
+        } else {
+            uint8_t adv_len;
+            uint8_t addr[6] = {0x10, 0x20, 0x30, 0x40, 0, 0};
+            if (e % 3 == 0) {
+                adv_len = make_phone_adv(adv, seed);
+                addr[4] = seed >> 8;
+                addr[5] = seed;
+            } else {
+                int badge = (int)(seed % badges);
+                adv_len = make_badge_adv(adv, badge);
+                addr[4] = badge >> 8;
+                addr[5] = badge;
+            }
+            len = host_vhci_make_adv_report(pkt, sizeof(pkt), addr, rssi, adv, adv_len);
+        }
+        hci_corpus_add(corpus, pkt, len);
+    }
+}
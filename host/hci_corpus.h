@@ -0,0 +1,35 @@
+#ifndef __HOST_HCI_CORPUS_H__
+#define __HOST_HCI_CORPUS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * A set of raw HCI packets as handed to the VHCI host callback. On disk a
+ * corpus is a sequence of records, each a little-endian uint16 length
+ * followed by that many packet bytes.
+ */
+
+typedef struct {
+    uint8_t *data;
+    uint16_t len;
+} hci_packet_t;
+
+typedef struct {
+    hci_packet_t *packets;
+    size_t count;
+    size_t capacity;
+} hci_corpus_t;
+
+int hci_corpus_load(hci_corpus_t *corpus, const char *path);
+int hci_corpus_add(hci_corpus_t *corpus, const uint8_t *data, uint16_t len);
+void hci_corpus_free(hci_corpus_t *corpus);
+
+/*
+ * Fill `corpus` with `events` synthetic LE Advertising Report events: a
+ * crowd of `badges` badges advertising "[id] name" mixed with phones and
+ * beacons that carry no name, and some multi-report events.
+ */
+void hci_corpus_synthesize(hci_corpus_t *corpus, size_t events, int badges);
+
+#endif
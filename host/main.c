@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "badge/badge.h"
+#include "host_shim.h"
+
+/*
+ * Host runner. `run` boots the firmware through app_main() and feeds the
+ * emulated controller with advertisements from a simulated crowd of badges.
+ */
+
+void app_main();
+
+typedef struct {
+    const char *name;
+    int (*fn)(int argc, char **argv);
+    const char *help;
+} host_cmd_t;
+
+typedef struct {
+    int badges;
+    int phones;
+    int interval_ms;
+    int leave_after_s;  // the second half of the badges go silent after this, 0 never
+} crowd_cfg_t;
+
+static crowd_cfg_t crowd = { .badges = 8, .phones = 0, .interval_ms = 100, .leave_after_s = 0 };
+
+/*
+ * Even badges send the manufacturer specific advertisement plus a scan
+ * response with their "[id] name", odd ones the name-only advertisement of
+ * older firmware.
+ */
+static uint16_t make_crowd_packets(int i, uint32_t round, uint8_t *pkt, size_t size, uint16_t *rsp_len)
+{
+    uint8_t adv[31];
+    uint8_t addr[6] = {0x10, 0x20, 0x30, 0x40, (uint8_t)(i >> 8), (uint8_t)i};
+    char name[29];
+    char id_name[32];
+    uint8_t id = 1 + i % 7;
+    snprintf(name, sizeof(name), "Saiyan-%04x", 0x1000 + i);
+    int name_len = snprintf(id_name, sizeof(id_name), "[%d] %s", id, name);
+    /* A fixed distance per badge with +-6 dB of fading on top. */
+    int8_t rssi = -25 - (int8_t)(i * 9 % 45) + (int8_t)((i * 31 + round * 17) % 13) - 6;
+
+    uint8_t name_ad[31];
+    name_ad[0] = name_len + 1;
+    name_ad[1] = 0x09;
+    memcpy(&name_ad[2], id_name, name_len);
+
+    uint8_t adv_len = 0;
+    adv[adv_len++] = 0x02;
+    adv[adv_len++] = 0x01;
+    adv[adv_len++] = 0x06;
+    *rsp_len = 0;
+    if (i % 2 == 0) {
+        badge_adv_t badge = {
+            .len = sizeof(badge_adv_t) - 1, .type = 0xFF, .company = BADGE_ADV_COMPANY_ID,
+            .magic = BADGE_ADV_MAGIC, .version = BADGE_ADV_VERSION, .id = id,
+            .name_hash = badge_name_hash(name),
+        };
+        memcpy(&adv[adv_len], &badge, sizeof(badge));
+        adv_len += sizeof(badge);
+
+        uint8_t *rsp = pkt + size / 2;
+        *rsp_len = host_vhci_make_adv_report(rsp, size / 2, addr, rssi, name_ad, name_len + 2);
+        rsp[5] = 0x04; /* event type: scan response */
+    } else {
+        memcpy(&adv[adv_len], name_ad, name_len + 2);
+        adv_len += name_len + 2;
+    }
+    return host_vhci_make_adv_report(pkt, size / 2, addr, rssi, adv, adv_len);
+}
+
+/* Phones and trackers: flags and Apple manufacturer data, no name. */
+static uint16_t make_phone_packet(int i, uint32_t round, uint8_t *pkt, size_t size)
+{
+    uint8_t addr[6] = {0x50, 0x60, 0x70, 0x80, (uint8_t)(i >> 8), (uint8_t)i};
+    uint8_t adv[31] = {0x02, 0x01, 0x1a, 0x1a, 0xff, 0x4c, 0x00, 0x10, 0x05};
+    for (int b = 9; b < 27; b++) {
+        adv[b] = (uint8_t)(i * 31 + b);
+    }
+    int8_t rssi = -50 - (int8_t)((i * 3 + round) % 40);
+    return host_vhci_make_adv_report(pkt, size, addr, rssi, adv, 27);
+}
+
+static void crowd_task(void *arg)
+{
+    uint8_t pkt[128];
+    uint32_t round = 0;
+    int devices = crowd.badges + crowd.phones;
+    uint32_t leave_tick = xTaskGetTickCount() + pdMS_TO_TICKS(crowd.leave_after_s * 1000);
+
+    while (1) {
+        bool left = crowd.leave_after_s && (int32_t)(xTaskGetTickCount() - leave_tick) >= 0;
+        for (int i = 0; i < devices; i++) {
+            if (left && i >= crowd.badges / 2 && i < crowd.badges) {
+                continue;
+            }
+            uint16_t rsp_len = 0;
+            uint16_t len = i < crowd.badges ? make_crowd_packets(i, round, pkt, sizeof(pkt), &rsp_len)
+                                            : make_phone_packet(i, round, pkt, sizeof(pkt));
+            host_vhci_inject(pkt, len);
+            if (rsp_len) {
+                host_vhci_inject(pkt + sizeof(pkt) / 2, rsp_len);
+            }
+            /* Spread the round like a real controller would, not in one burst. */
+            usleep(crowd.interval_ms * 1000 / devices);
+        }
+        round++;
+    }
+}
+
+static void print_heap_stats(const char *label)
+{
+    host_heap_stats_t stats;
+    host_heap_stats_get(&stats);
+    printf("%s: mallocs=%llu frees=%llu bytes=%llu free_heap=%lu\n", label,
+           (unsigned long long)stats.mallocs, (unsigned long long)stats.frees,
+           (unsigned long long)stats.bytes, (unsigned long)esp_get_free_heap_size());
+}
+
+static esp_err_t write_history(void *ctx, const void *data, size_t len)
+{
+    return fwrite(data, 1, len, ctx) == len ? ESP_OK : ESP_FAIL;
+}
+
+/* Export the sighting log like POST /api/v1/history does and count it back. */
+static void export_history(const char *path)
+{
+    FILE *f = fopen(path, "w+b");
+    if (!f) {
+        perror(path);
+        return;
+    }
+    uint8_t buf[2048];
+    esp_err_t err = history_export(write_history, f, buf, sizeof(buf));
+
+    uint32_t sectors = 0, records = 0;
+    history_sector_t hdr;
+    rewind(f);
+    while (fread(&hdr, sizeof(hdr), 1, f) == 1 && hdr.magic == HISTORY_MAGIC) {
+        sectors++;
+        records += hdr.count;
+        fseek(f, hdr.count * sizeof(history_rec_t), SEEK_CUR);
+    }
+    printf("history export: %s err=%d sectors=%u records=%u bytes=%ld\n", path, err, sectors, records, ftell(f));
+    fclose(f);
+}
+
+static int cmd_run(int argc, char **argv)
+{
+    int seconds = 30;
+    const char *capture = NULL;
+    const char *history = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:n:p:i:c:x:o:")) != -1) {
+        switch (opt) {
+            case 't': seconds = atoi(optarg); break;
+            case 'n': crowd.badges = atoi(optarg); break;
+            case 'p': crowd.phones = atoi(optarg); break;
+            case 'c': capture = optarg; break;
+            case 'i': crowd.interval_ms = atoi(optarg); break;
+            case 'x': crowd.leave_after_s = atoi(optarg); break;
+            case 'o': history = optarg; break;
+            default: return 2;
+        }
+    }
+
+    app_main();
+    print_heap_stats("boot");
+    host_heap_stats_reset();
+
+    if (capture) {
+        bt_capture_start(capture, 64 * 1024 * 1024);
+    }
+    xTaskCreate(crowd_task, "crowd", 4096, NULL, 5, NULL);
+    for (int s = 0; s < seconds; s++) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+
+    if (capture) {
+        bt_capture_stop();
+    }
+    printf("nearby=%u set_complete=%d hci_cmds=%u\n", count_ble_nodes(), check_ble_set(),
+           host_vhci_commands_sent());
+    bt_pkt_pool_stats_t pool;
+    bt_get_pkt_pool_stats(&pool);
+    printf("controller: filtered=%u scan_refreshes=%u\n", host_vhci_filtered(), pool.scan_refreshes);
+    printf("hci pool: received=%u rejected=%u dropped=%u oversized=%u high_water=%u/%d\n", pool.received,
+           pool.rejected, pool.dropped, pool.oversized, pool.high_water, BT_PKT_POOL_SLOTS);
+    bt_scan_state_t scan;
+    bt_get_scan_state(&scan);
+    printf("scan: profile=%s active=%d duty=%u.%u%% est_current=%.1fmA\n", scan.profile, scan.active,
+           scan.duty_permille / 10, scan.duty_permille % 10, scan.est_current_ua / 1000.0);
+    bt_node_stats_t nodes;
+    bt_get_node_stats(&nodes);
+    printf("nodes: updates=%u bucket_changes=%u publishes=%u\n", nodes.updates, nodes.bucket_changes,
+           nodes.publishes);
+    printf("expiry: expired=%u jitter_avg=%.1fms jitter_max=%ums\n", nodes.expired,
+           nodes.expired ? nodes.jitter_total_ms / (double)nodes.expired : 0.0, nodes.jitter_max_ms);
+    history_flush();
+    vTaskDelay(pdMS_TO_TICKS(500));
+    history_stats_t hist;
+    history_get_stats(&hist);
+    printf("history: logged=%u dropped=%u flushed=%u erased=%u flush_max=%.1fms\n", hist.logged, hist.dropped,
+           hist.flushed, hist.erased, hist.flush_max_us / 1000.0);
+    if (history) {
+        export_history(history);
+    }
+    printf("wakeups/s: bt_task=%.1f led_task=%.1f\n", host_task_wakeups("bt_task") / (double)seconds,
+           host_task_wakeups("led_task") / (double)seconds);
+    print_heap_stats("run");
+    return 0;
+}
+
+static int cmd_help(int argc, char **argv);
+int bench_adv(int argc, char **argv);
+int stress_nodes(int argc, char **argv);
+int replay(int argc, char **argv);
+int fuzz_adv(int argc, char **argv);
+int wifi_switch(int argc, char **argv);
+int bench_beacon(int argc, char **argv);
+int bench_www(int argc, char **argv);
+int check_json(int argc, char **argv);
+int bench_api(int argc, char **argv);
+
+static const host_cmd_t commands[] = {
+    { "run", cmd_run, "run [-t seconds] [-n badges] [-p phones] [-i interval_ms] [-c capture] [-x leave_after_s] [-o history]  boot the firmware next to a simulated crowd" },
+    { "bench-adv", bench_adv, "bench-adv [-f corpus] [-r rounds] [-n badges]  advertising report parser throughput" },
+    { "stress-nodes", stress_nodes, "stress-nodes [-t seconds] [-r readers] [-n badges]  concurrent nearby table snapshots" },
+    { "replay", replay, "replay -f capture [-r packets_per_sec] [-l loops]  feed a capture to the booted firmware" },
+    { "fuzz-adv", fuzz_adv, "fuzz-adv [-f capture] [-i iterations] [-s seed]  mutate packets into the advertising parser" },
+    { "wifi-switch", wifi_switch, "wifi-switch [-r rounds]  time every WiFi radio mode transition" },
+    { "bench-beacon", bench_beacon, "bench-beacon [-r rounds]  marauder beacon preparation, rebuilt against patched template" },
+    { "bench-www", bench_www, "bench-www [-r rounds]  web UI GET from SPIFFS against the packed www partition" },
+    { "check-json", check_json, "check-json  REST reply writer output against known answers" },
+    { "bench-api", bench_api, "bench-api [-r rounds] [-n badges]  heap calls and latency of each REST handler" },
+    { "help", cmd_help, "help  list commands" },
+};
+
+static int cmd_help(int argc, char **argv)
+{
+    printf("usage: badge-host <command> [options]\n");
+    for (size_t i = 0; i < SIZEOF(commands); i++) {
+        printf("  %s\n", commands[i].help);
+    }
+    printf("Set BADGE_HOST_LOG=0..5 to change the log level (default 3, INFO).\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = argc > 1 ? argv[1] : "run";
+    for (size_t i = 0; i < SIZEOF(commands); i++) {
+        if (!strcmp(commands[i].name, name)) {
+            return commands[i].fn(argc > 1 ? argc - 1 : argc, argc > 1 ? argv + 1 : argv);
+        }
+    }
+    cmd_help(argc, argv);
+    return 2;
+}
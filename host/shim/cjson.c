@@ -0,0 +1,587 @@
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "cJSON.h"
+
+/*
+ * Minimal cJSON: a recursive-descent parser and a formatted printer for
+ * the settings files and REST request bodies. Parse errors return NULL
+ * like cJSON; anything it doesn't need (hooks, arrays API, unformatted
+ * print) is left out.
+ */
+
+#define NESTING_LIMIT 1000
+
+typedef struct {
+    const char *pos;
+    int depth;
+} parser_t;
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t size;
+} printer_t;
+
+static cJSON *new_item(void)
+{
+    return calloc(1, sizeof(cJSON));
+}
+
+/* Not strdup(): libc's own malloc call would go past the --wrap counters. */
+static char *copy_string(const char *s)
+{
+    size_t len = strlen(s) + 1;
+    char *copy = malloc(len);
+    if (copy) {
+        memcpy(copy, s, len);
+    }
+    return copy;
+}
+
+void cJSON_Delete(cJSON *item)
+{
+    while (item) {
+        cJSON *next = item->next;
+        cJSON_Delete(item->child);
+        free(item->valuestring);
+        free(item->string);
+        free(item);
+        item = next;
+    }
+}
+
+void cJSON_free(void *object)
+{
+    free(object);
+}
+
+static void skip_ws(parser_t *p)
+{
+    while (*p->pos && (unsigned char)*p->pos <= ' ') {
+        p->pos++;
+    }
+}
+
+static bool parse_hex4(const char *s, unsigned *out)
+{
+    unsigned v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = s[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') {
+            v |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            v |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            v |= c - 'A' + 10;
+        } else {
+            return false;
+        }
+    }
+    *out = v;
+    return true;
+}
+
+static size_t put_utf8(char *out, unsigned cp)
+{
+    if (cp < 0x80) {
+        out[0] = cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = 0xC0 | (cp >> 6);
+        out[1] = 0x80 | (cp & 0x3F);
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = 0xE0 | (cp >> 12);
+        out[1] = 0x80 | ((cp >> 6) & 0x3F);
+        out[2] = 0x80 | (cp & 0x3F);
+        return 3;
+    }
+    out[0] = 0xF0 | (cp >> 18);
+    out[1] = 0x80 | ((cp >> 12) & 0x3F);
+    out[2] = 0x80 | ((cp >> 6) & 0x3F);
+    out[3] = 0x80 | (cp & 0x3F);
+    return 4;
+}
+
+/* Parses the string at p->pos (on the opening quote) into a new block. */
+static char *parse_string(parser_t *p)
+{
+    const char *end = p->pos + 1;
+    while (*end && *end != '"') {
+        if (*end == '\\' && end[1]) {
+            end++;
+        }
+        end++;
+    }
+    if (*end != '"') {
+        return NULL;
+    }
+
+    /* Escapes only ever shrink, so the raw length is enough. */
+    char *out = malloc(end - p->pos);
+    if (!out) {
+        return NULL;
+    }
+    size_t len = 0;
+    const char *s = p->pos + 1;
+    while (s < end) {
+        if (*s != '\\') {
+            out[len++] = *s++;
+            continue;
+        }
+        s++;
+        switch (*s++) {
+        case '"': out[len++] = '"'; break;
+        case '\\': out[len++] = '\\'; break;
+        case '/': out[len++] = '/'; break;
+        case 'b': out[len++] = '\b'; break;
+        case 'f': out[len++] = '\f'; break;
+        case 'n': out[len++] = '\n'; break;
+        case 'r': out[len++] = '\r'; break;
+        case 't': out[len++] = '\t'; break;
+        case 'u': {
+            unsigned cp, lo;
+            if (end - s < 4 || !parse_hex4(s, &cp)) {
+                goto fail;
+            }
+            s += 4;
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                if (end - s < 6 || s[0] != '\\' || s[1] != 'u' || !parse_hex4(s + 2, &lo) ||
+                    lo < 0xDC00 || lo > 0xDFFF) {
+                    goto fail;
+                }
+                s += 6;
+                cp = 0x10000 + (((cp & 0x3FF) << 10) | (lo & 0x3FF));
+            } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                goto fail;
+            }
+            len += put_utf8(out + len, cp);
+            break;
+        }
+        default:
+            goto fail;
+        }
+    }
+    out[len] = '\0';
+    p->pos = end + 1;
+    return out;
+
+fail:
+    free(out);
+    return NULL;
+}
+
+static bool parse_value(parser_t *p, cJSON *item);
+
+static bool parse_container(parser_t *p, cJSON *item, bool object)
+{
+    char close = object ? '}' : ']';
+    cJSON *tail = NULL;
+
+    if (++p->depth > NESTING_LIMIT) {
+        return false;
+    }
+    item->type = object ? cJSON_Object : cJSON_Array;
+    p->pos++;
+    skip_ws(p);
+    if (*p->pos == close) {
+        p->pos++;
+        p->depth--;
+        return true;
+    }
+
+    for (;;) {
+        cJSON *child = new_item();
+        if (!child) {
+            return false;
+        }
+        if (tail) {
+            tail->next = child;
+            child->prev = tail;
+        } else {
+            item->child = child;
+        }
+        tail = child;
+        /* cJSON keeps the last child in the first one's prev. */
+        item->child->prev = tail;
+
+        skip_ws(p);
+        if (object) {
+            if (*p->pos != '"' || !(child->string = parse_string(p))) {
+                return false;
+            }
+            skip_ws(p);
+            if (*p->pos++ != ':') {
+                return false;
+            }
+            skip_ws(p);
+        }
+        if (!parse_value(p, child)) {
+            return false;
+        }
+        skip_ws(p);
+        if (*p->pos == ',') {
+            p->pos++;
+            continue;
+        }
+        if (*p->pos != close) {
+            return false;
+        }
+        p->pos++;
+        p->depth--;
+        return true;
+    }
+}
+
+static bool parse_number(parser_t *p, cJSON *item)
+{
+    char *end;
+    double d = strtod(p->pos, &end);
+    if (end == p->pos) {
+        return false;
+    }
+    item->type = cJSON_Number;
+    item->valuedouble = d;
+    if (d >= 2147483647.0) {
+        item->valueint = 2147483647;
+    } else if (d <= -2147483648.0) {
+        item->valueint = -2147483647 - 1;
+    } else {
+        item->valueint = (int)d;
+    }
+    p->pos = end;
+    return true;
+}
+
+static bool parse_value(parser_t *p, cJSON *item)
+{
+    const char *s = p->pos;
+    if (!strncmp(s, "null", 4)) {
+        item->type = cJSON_NULL;
+        p->pos += 4;
+        return true;
+    }
+    if (!strncmp(s, "false", 5)) {
+        item->type = cJSON_False;
+        p->pos += 5;
+        return true;
+    }
+    if (!strncmp(s, "true", 4)) {
+        item->type = cJSON_True;
+        item->valueint = 1;
+        p->pos += 4;
+        return true;
+    }
+    if (*s == '"') {
+        item->type = cJSON_String;
+        return (item->valuestring = parse_string(p)) != NULL;
+    }
+    if (*s == '-' || isdigit((unsigned char)*s)) {
+        return parse_number(p, item);
+    }
+    if (*s == '{' || *s == '[') {
+        return parse_container(p, item, *s == '{');
+    }
+    return false;
+}
+
+cJSON *cJSON_Parse(const char *value)
+{
+    if (!value) {
+        return NULL;
+    }
+    parser_t p = { .pos = value };
+    cJSON *item = new_item();
+    if (!item) {
+        return NULL;
+    }
+    skip_ws(&p);
+    if (!parse_value(&p, item)) {
+        cJSON_Delete(item);
+        return NULL;
+    }
+    return item;
+}
+
+static bool print_reserve(printer_t *pr, size_t needed)
+{
+    if (pr->len + needed + 1 <= pr->size) {
+        return true;
+    }
+    size_t size = pr->size;
+    while (size < pr->len + needed + 1) {
+        size *= 2;
+    }
+    char *buf = realloc(pr->buf, size);
+    if (!buf) {
+        return false;
+    }
+    pr->buf = buf;
+    pr->size = size;
+    return true;
+}
+
+static bool print_raw(printer_t *pr, const char *s, size_t len)
+{
+    if (!print_reserve(pr, len)) {
+        return false;
+    }
+    memcpy(pr->buf + pr->len, s, len);
+    pr->len += len;
+    pr->buf[pr->len] = '\0';
+    return true;
+}
+
+static bool print_indent(printer_t *pr, int depth)
+{
+    if (!print_reserve(pr, depth)) {
+        return false;
+    }
+    memset(pr->buf + pr->len, '\t', depth);
+    pr->len += depth;
+    pr->buf[pr->len] = '\0';
+    return true;
+}
+
+static bool print_string(printer_t *pr, const char *s)
+{
+    if (!s) {
+        s = "";
+    }
+    if (!print_raw(pr, "\"", 1)) {
+        return false;
+    }
+    for (; *s; s++) {
+        unsigned char c = *s;
+        char esc[8];
+        const char *out = esc;
+        size_t len = 2;
+        switch (c) {
+        case '"': out = "\\\""; break;
+        case '\\': out = "\\\\"; break;
+        case '\b': out = "\\b"; break;
+        case '\f': out = "\\f"; break;
+        case '\n': out = "\\n"; break;
+        case '\r': out = "\\r"; break;
+        case '\t': out = "\\t"; break;
+        default:
+            if (c < 32) {
+                len = snprintf(esc, sizeof(esc), "\\u%04x", c);
+            } else {
+                esc[0] = c;
+                len = 1;
+            }
+        }
+        if (!print_raw(pr, out, len)) {
+            return false;
+        }
+    }
+    return print_raw(pr, "\"", 1);
+}
+
+static bool print_number(printer_t *pr, double d)
+{
+    char num[32];
+    int len;
+    if (isnan(d) || isinf(d)) {
+        len = snprintf(num, sizeof(num), "null");
+    } else if (d == (double)(int)d) {
+        len = snprintf(num, sizeof(num), "%d", (int)d);
+    } else {
+        /* Shortest of 15 or 17 digits that reads back the same, as cJSON. */
+        len = snprintf(num, sizeof(num), "%1.15g", d);
+        if (strtod(num, NULL) != d) {
+            len = snprintf(num, sizeof(num), "%1.17g", d);
+        }
+    }
+    return print_raw(pr, num, len);
+}
+
+static bool print_value(printer_t *pr, const cJSON *item, int depth)
+{
+    switch (item->type & 0xFF) {
+    case cJSON_NULL:
+        return print_raw(pr, "null", 4);
+    case cJSON_False:
+        return print_raw(pr, "false", 5);
+    case cJSON_True:
+        return print_raw(pr, "true", 4);
+    case cJSON_Number:
+        return print_number(pr, item->valuedouble);
+    case cJSON_String:
+        return print_string(pr, item->valuestring);
+    case cJSON_Array:
+        if (!print_raw(pr, "[", 1)) {
+            return false;
+        }
+        for (const cJSON *c = item->child; c; c = c->next) {
+            if (!print_value(pr, c, depth + 1) ||
+                (c->next && !print_raw(pr, ", ", 2))) {
+                return false;
+            }
+        }
+        return print_raw(pr, "]", 1);
+    case cJSON_Object:
+        if (!print_raw(pr, "{\n", 2)) {
+            return false;
+        }
+        for (const cJSON *c = item->child; c; c = c->next) {
+            if (!print_indent(pr, depth + 1) || !print_string(pr, c->string) ||
+                !print_raw(pr, ":\t", 2) || !print_value(pr, c, depth + 1) ||
+                (c->next && !print_raw(pr, ",", 1)) || !print_raw(pr, "\n", 1)) {
+                return false;
+            }
+        }
+        return print_indent(pr, depth) && print_raw(pr, "}", 1);
+    default:
+        return false;
+    }
+}
+
+char *cJSON_Print(const cJSON *item)
+{
+    printer_t pr = { .size = 256 };
+    if (!item || !(pr.buf = malloc(pr.size))) {
+        return NULL;
+    }
+    pr.buf[0] = '\0';
+    if (!print_value(&pr, item, 0)) {
+        free(pr.buf);
+        return NULL;
+    }
+    /* cJSON trims the buffer to the printed length before returning it. */
+    char *out = realloc(pr.buf, pr.len + 1);
+    return out ? out : pr.buf;
+}
+
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *string)
+{
+    if (!object || !string) {
+        return NULL;
+    }
+    /* Case-insensitive, like cJSON_GetObjectItem (not ...CaseSensitive). */
+    for (cJSON *c = object->child; c; c = c->next) {
+        if (c->string && !strcasecmp(c->string, string)) {
+            return c;
+        }
+    }
+    return NULL;
+}
+
+cJSON_bool cJSON_IsFalse(const cJSON *item)
+{
+    return item && (item->type & 0xFF) == cJSON_False;
+}
+
+cJSON_bool cJSON_IsTrue(const cJSON *item)
+{
+    return item && (item->type & 0xFF) == cJSON_True;
+}
+
+cJSON_bool cJSON_IsString(const cJSON *item)
+{
+    return item && (item->type & 0xFF) == cJSON_String;
+}
+
+cJSON_bool cJSON_IsObject(const cJSON *item)
+{
+    return item && (item->type & 0xFF) == cJSON_Object;
+}
+
+cJSON *cJSON_CreateObject(void)
+{
+    cJSON *item = new_item();
+    if (item) {
+        item->type = cJSON_Object;
+    }
+    return item;
+}
+
+cJSON_bool cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item)
+{
+    if (!object || !string || !item || object == item) {
+        return false;
+    }
+    char *key = copy_string(string);
+    if (!key) {
+        return false;
+    }
+    free(item->string);
+    item->string = key;
+
+    if (!object->child) {
+        object->child = item;
+        item->prev = item;
+        item->next = NULL;
+    } else {
+        cJSON *tail = object->child->prev;
+        tail->next = item;
+        item->prev = tail;
+        item->next = NULL;
+        object->child->prev = item;
+    }
+    return true;
+}
+
+cJSON *cJSON_AddStringToObject(cJSON *object, const char *name, const char *string)
+{
+    cJSON *item = new_item();
+    if (!item) {
+        return NULL;
+    }
+    item->type = cJSON_String;
+    if (!string || !(item->valuestring = copy_string(string)) ||
+        !cJSON_AddItemToObject(object, name, item)) {
+        cJSON_Delete(item);
+        return NULL;
+    }
+    return item;
+}
+
+cJSON *cJSON_AddNumberToObject(cJSON *object, const char *name, double number)
+{
+    cJSON *item = new_item();
+    if (!item) {
+        return NULL;
+    }
+    item->type = cJSON_Number;
+    item->valuedouble = number;
+    item->valueint = number >= 2147483647.0 ? 2147483647 :
+                     number <= -2147483648.0 ? -2147483647 - 1 : (int)number;
+    if (!cJSON_AddItemToObject(object, name, item)) {
+        cJSON_Delete(item);
+        return NULL;
+    }
+    return item;
+}
+
+void cJSON_DeleteItemFromObject(cJSON *object, const char *string)
+{
+    cJSON *item = cJSON_GetObjectItem(object, string);
+    if (!item) {
+        return;
+    }
+    if (item == object->child) {
+        object->child = item->next;
+        if (object->child) {
+            object->child->prev = item->prev;
+        }
+    } else {
+        item->prev->next = item->next;
+        if (item->next) {
+            item->next->prev = item->prev;
+        } else {
+            object->child->prev = item->prev;
+        }
+    }
+    item->next = item->prev = NULL;
+    cJSON_Delete(item);
+}
@@ -0,0 +1,52 @@
+#ifndef __HOST_CJSON_H__
+#define __HOST_CJSON_H__
+
+#include <stdbool.h>
+
+/*
+ * The part of the cJSON API the firmware uses, for hosts without
+ * libcjson-dev. Item layout, type flags and allocation pattern (one block
+ * per item, key and string value) follow cJSON so heap counts match.
+ */
+
+#define cJSON_Invalid (0)
+#define cJSON_False  (1 << 0)
+#define cJSON_True   (1 << 1)
+#define cJSON_NULL   (1 << 2)
+#define cJSON_Number (1 << 3)
+#define cJSON_String (1 << 4)
+#define cJSON_Array  (1 << 5)
+#define cJSON_Object (1 << 6)
+
+typedef int cJSON_bool;
+
+typedef struct cJSON {
+    struct cJSON *next;
+    struct cJSON *prev;
+    struct cJSON *child;
+    int type;
+    char *valuestring;
+    int valueint;
+    double valuedouble;
+    char *string;
+} cJSON;
+
+cJSON *cJSON_Parse(const char *value);
+char *cJSON_Print(const cJSON *item);
+void cJSON_Delete(cJSON *item);
+void cJSON_free(void *object);
+
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *string);
+
+cJSON_bool cJSON_IsFalse(const cJSON *item);
+cJSON_bool cJSON_IsTrue(const cJSON *item);
+cJSON_bool cJSON_IsString(const cJSON *item);
+cJSON_bool cJSON_IsObject(const cJSON *item);
+
+cJSON *cJSON_CreateObject(void);
+cJSON_bool cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item);
+cJSON *cJSON_AddStringToObject(cJSON *object, const char *name, const char *string);
+cJSON *cJSON_AddNumberToObject(cJSON *object, const char *name, double number);
+void cJSON_DeleteItemFromObject(cJSON *object, const char *string);
+
+#endif
@@ -0,0 +1,94 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "driver/i2c.h"
+#include "esp_log.h"
+#include "common/led_strip.h"
+
+/*
+ * I2C (AW9523 LED driver) and WS2812 strip stand-ins. Writes are only
+ * recorded so the LED logic can run unchanged.
+ */
+
+#define TAG "host_drivers"
+
+typedef struct {
+    led_strip_t parent;
+    uint32_t max_leds;
+    uint8_t pixels[];
+} host_strip_t;
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, i2c_mode_t mode, size_t slv_rx_buf_len,
+                             size_t slv_tx_buf_len, int intr_alloc_flags)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write_to_device(i2c_port_t i2c_num, uint8_t device_address,
+                                     const uint8_t *write_buffer, size_t write_size,
+                                     TickType_t ticks_to_wait)
+{
+    ESP_LOGV(TAG, "i2c 0x%02x: reg 0x%02x = 0x%02x", device_address, write_buffer[0],
+             write_size > 1 ? write_buffer[1] : 0);
+    return ESP_OK;
+}
+
+static esp_err_t strip_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    host_strip_t *s = (host_strip_t *)strip;
+    if (index >= s->max_leds) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s->pixels[index * 3 + 0] = green;
+    s->pixels[index * 3 + 1] = red;
+    s->pixels[index * 3 + 2] = blue;
+    return ESP_OK;
+}
+
+static esp_err_t strip_refresh(led_strip_t *strip, uint32_t timeout_ms)
+{
+    return ESP_OK;
+}
+
+static esp_err_t strip_clear(led_strip_t *strip, uint32_t timeout_ms)
+{
+    host_strip_t *s = (host_strip_t *)strip;
+    memset(s->pixels, 0, s->max_leds * 3);
+    return ESP_OK;
+}
+
+static esp_err_t strip_del(led_strip_t *strip)
+{
+    free(strip);
+    return ESP_OK;
+}
+
+led_strip_t *led_strip_new_rmt_ws2812(const led_strip_config_t *config)
+{
+    host_strip_t *s = calloc(1, sizeof(host_strip_t) + config->max_leds * 3);
+    if (!s) {
+        return NULL;
+    }
+    s->max_leds = config->max_leds;
+    s->parent.set_pixel = strip_set_pixel;
+    s->parent.refresh = strip_refresh;
+    s->parent.clear = strip_clear;
+    s->parent.del = strip_del;
+    return &s->parent;
+}
+
+led_strip_t *led_strip_init(rmt_channel_t channel, gpio_num_t gpio, uint16_t led_num)
+{
+    led_strip_config_t config = LED_STRIP_DEFAULT_CONFIG(led_num, (led_strip_dev_t)channel);
+    return led_strip_new_rmt_ws2812(&config);
+}
+
+esp_err_t led_strip_denit(led_strip_t *strip)
+{
+    return strip->del(strip);
+}
@@ -0,0 +1,164 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "esp_bt.h"
+#include "esp_log.h"
+#include "host_shim.h"
+
+/*
+ * Emulated BLE controller. Every HCI command is acknowledged straight away
+ * with a successful Command Complete event; advertising reports are pushed
+ * in by the host runner through host_vhci_inject(). LE Set Scan Enable is
+ * honoured, including duplicate filtering.
+ */
+
+#define H4_TYPE_CMD     0x01
+#define H4_TYPE_EVT     0x04
+#define HCI_EVT_CMD_CMPL 0x0e
+#define HCI_LE_SET_SCAN_ENABLE 0x200c
+#define SEEN_MAX 1024
+
+static const esp_vhci_host_callback_t *vhci_cb;
+static pthread_mutex_t vhci_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_uint commands_sent;
+static atomic_uint filtered;
+
+/* Scan state, under vhci_lock. */
+static bool scanning;
+static bool filter_duplicates;
+static uint8_t seen[SEEN_MAX][7]; // event type + address
+static int seen_count;
+
+esp_err_t esp_bt_controller_mem_release(esp_bt_mode_t mode)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t *cfg)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode)
+{
+    return mode == ESP_BT_MODE_BLE ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_vhci_host_register_callback(const esp_vhci_host_callback_t *callback)
+{
+    vhci_cb = callback;
+    return ESP_OK;
+}
+
+bool esp_vhci_host_check_send_available(void)
+{
+    return true;
+}
+
+void esp_vhci_host_send_packet(uint8_t *data, uint16_t len)
+{
+    if (len < 4 || data[0] != H4_TYPE_CMD) {
+        return;
+    }
+    atomic_fetch_add(&commands_sent, 1);
+
+    uint16_t opcode = data[1] | (data[2] << 8);
+    if (opcode == HCI_LE_SET_SCAN_ENABLE && len >= 6) {
+        pthread_mutex_lock(&vhci_lock);
+        scanning = data[4];
+        filter_duplicates = data[5];
+        seen_count = 0;
+        pthread_mutex_unlock(&vhci_lock);
+    }
+
+    /* H4 | event code | param len | num HCI packets | opcode (LE) | status */
+    uint8_t evt[7] = {H4_TYPE_EVT, HCI_EVT_CMD_CMPL, 4, 1, data[1], data[2], 0x00};
+    host_vhci_inject(evt, sizeof(evt));
+}
+
+/* Single report events only, which is all the host runner builds. */
+static bool scan_filter(const uint8_t *data, uint16_t len)
+{
+    if (len < 13 || data[1] != 0x3e || data[3] != 0x02) {
+        return false;
+    }
+    if (!scanning) {
+        return true;
+    }
+    if (!filter_duplicates || data[4] != 1) {
+        return false;
+    }
+    const uint8_t *key = &data[5]; // event type, skip address type
+    for (int i = 0; i < seen_count; i++) {
+        if (seen[i][0] == key[0] && !memcmp(&seen[i][1], &key[2], 6)) {
+            return true;
+        }
+    }
+    if (seen_count < SEEN_MAX) {
+        seen[seen_count][0] = key[0];
+        memcpy(&seen[seen_count][1], &key[2], 6);
+        seen_count++;
+    }
+    return false;
+}
+
+int host_vhci_inject(uint8_t *data, uint16_t len)
+{
+    int ret = ESP_FAIL;
+    /* The real controller calls back from a single task; serialise likewise. */
+    pthread_mutex_lock(&vhci_lock);
+    if (scan_filter(data, len)) {
+        atomic_fetch_add(&filtered, 1);
+    } else if (vhci_cb && vhci_cb->notify_host_recv) {
+        ret = vhci_cb->notify_host_recv(data, len);
+    }
+    pthread_mutex_unlock(&vhci_lock);
+    return ret;
+}
+
+int host_vhci_deliver(uint8_t *data, uint16_t len)
+{
+    int ret = ESP_FAIL;
+    pthread_mutex_lock(&vhci_lock);
+    if (vhci_cb && vhci_cb->notify_host_recv) {
+        ret = vhci_cb->notify_host_recv(data, len);
+    }
+    pthread_mutex_unlock(&vhci_lock);
+    return ret;
+}
+
+uint16_t host_vhci_make_adv_report(uint8_t *buf, size_t size, const uint8_t addr[6],
+                                   int8_t rssi, const uint8_t *adv_data, uint8_t adv_len)
+{
+    /* H4 | 0x3e | len | subevent | num reports | evt type | addr type | addr | data len | data | rssi */
+    uint16_t total = 3 + 1 + 1 + 1 + 1 + 6 + 1 + adv_len + 1;
+    if (total > size || total - 3 > 0xff) {
+        return 0;
+    }
+    uint8_t *p = buf;
+    *p++ = H4_TYPE_EVT;
+    *p++ = 0x3e;
+    *p++ = (uint8_t)(total - 3);
+    *p++ = 0x02;
+    *p++ = 1;
+    *p++ = 0x00;
+    *p++ = 0x00;
+    memcpy(p, addr, 6);
+    p += 6;
+    *p++ = adv_len;
+    memcpy(p, adv_data, adv_len);
+    p += adv_len;
+    *p++ = (uint8_t)rssi;
+    return total;
+}
+
+uint32_t host_vhci_commands_sent(void)
+{
+    return atomic_load(&commands_sent);
+}
+
+uint32_t host_vhci_filtered(void)
+{
+    return atomic_load(&filtered);
+}
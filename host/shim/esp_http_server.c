@@ -0,0 +1,263 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "host_shim.h"
+
+/*
+ * In-process esp_http_server. Handlers run synchronously on the caller's
+ * thread; whatever they send is appended to a host_httpd_response_t.
+ */
+
+#define URI_HANDLERS_MAX 16
+
+/* The response stands in for the socket, not the badge's heap: keep it out
+ * of host_heap_stats so the counts are the handler's own. */
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+typedef struct {
+    httpd_config_t config;
+    httpd_uri_t handlers[URI_HANDLERS_MAX];
+    int handlers_num;
+} host_httpd_t;
+
+typedef struct {
+    const char *req_headers;
+    const char *body;
+    size_t body_off;
+    host_httpd_response_t *resp;
+    bool status_set;
+} host_httpd_aux_t;
+
+static void resp_append(host_httpd_response_t *resp, const char *buf, size_t len)
+{
+    if (!len) {
+        return;
+    }
+    resp->body = __real_realloc(resp->body, resp->body_len + len + 1);
+    memcpy(resp->body + resp->body_len, buf, len);
+    resp->body_len += len;
+    resp->body[resp->body_len] = '\0';
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    host_httpd_t *server = calloc(1, sizeof(*server));
+    if (!server) {
+        return ESP_ERR_NO_MEM;
+    }
+    server->config = *config;
+    *handle = server;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    host_httpd_t *server = handle;
+    if (!server) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (server->config.global_user_ctx_free_fn) {
+        server->config.global_user_ctx_free_fn(server->config.global_user_ctx);
+    }
+    free(server);
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    host_httpd_t *server = handle;
+    if (server->handlers_num >= URI_HANDLERS_MAX ||
+        server->handlers_num >= server->config.max_uri_handlers) {
+        return ESP_ERR_NO_MEM;
+    }
+    server->handlers[server->handlers_num++] = *uri_handler;
+    return ESP_OK;
+}
+
+bool httpd_uri_match_wildcard(const char *uri_template, const char *uri_to_match, size_t match_upto)
+{
+    size_t tpl_len = strlen(uri_template);
+    if (tpl_len && uri_template[tpl_len - 1] == '*') {
+        return strncmp(uri_template, uri_to_match, tpl_len - 1) == 0;
+    }
+    return strlen(uri_to_match) >= match_upto && match_upto == tpl_len &&
+           strncmp(uri_template, uri_to_match, match_upto) == 0;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    host_httpd_aux_t *aux = r->aux;
+    size_t left = r->content_len - aux->body_off;
+    size_t n = left < buf_len ? left : buf_len;
+    if (!aux->body) {
+        return 0;
+    }
+    memcpy(buf, aux->body + aux->body_off, n);
+    aux->body_off += n;
+    return (int)n;
+}
+
+/* Find `field` in a "Name: value\r\n" header block; returns value and its length. */
+static const char *find_header(const char *headers, const char *field, size_t *len)
+{
+    size_t field_len = strlen(field);
+    const char *line = headers;
+    while (line && *line) {
+        const char *end = strstr(line, "\r\n");
+        if (!end) {
+            end = line + strlen(line);
+        }
+        if (!strncasecmp(line, field, field_len) && line[field_len] == ':') {
+            const char *value = line + field_len + 1;
+            while (*value == ' ') {
+                value++;
+            }
+            *len = end - value;
+            return value;
+        }
+        line = *end ? end + 2 : end;
+    }
+    return NULL;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field)
+{
+    host_httpd_aux_t *aux = r->aux;
+    size_t len = 0;
+    return find_header(aux->req_headers, field, &len) ? len : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size)
+{
+    host_httpd_aux_t *aux = r->aux;
+    size_t len = 0;
+    const char *value = find_header(aux->req_headers, field, &len);
+    if (!value) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (val_size == 0) {
+        return ESP_ERR_HTTPD_RESULT_TRUNC;
+    }
+    size_t n = len < val_size - 1 ? len : val_size - 1;
+    memcpy(val, value, n);
+    val[n] = '\0';
+    return n < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r)
+{
+    return 3;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+    host_httpd_aux_t *aux = r->aux;
+    aux->resp->status = atoi(status);
+    aux->status_set = true;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    host_httpd_aux_t *aux = r->aux;
+    snprintf(aux->resp->type, sizeof(aux->resp->type), "%s", type);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+    host_httpd_aux_t *aux = r->aux;
+    size_t used = strlen(aux->resp->headers);
+    snprintf(aux->resp->headers + used, sizeof(aux->resp->headers) - used, "%s: %s\r\n", field, value);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    host_httpd_aux_t *aux = r->aux;
+    if (!aux->status_set) {
+        aux->resp->status = 200;
+    }
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = strlen(buf);
+    }
+    resp_append(aux->resp, buf, buf_len);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    host_httpd_aux_t *aux = r->aux;
+    if (!aux->status_set) {
+        aux->resp->status = 200;
+    }
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = strlen(buf);
+    }
+    if (buf && buf_len > 0) {
+        aux->resp->chunks++;
+        resp_append(aux->resp, buf, buf_len);
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+    static const int codes[HTTPD_ERR_CODE_MAX] = {
+        500, 501, 505, 400, 401, 403, 404, 405, 408, 411, 414, 431
+    };
+    host_httpd_aux_t *aux = req->aux;
+    aux->resp->status = codes[error];
+    aux->status_set = true;
+    __real_free(aux->resp->body);
+    aux->resp->body = NULL;
+    aux->resp->body_len = 0;
+    resp_append(aux->resp, msg, strlen(msg));
+    return ESP_OK;
+}
+
+esp_err_t host_httpd_request(httpd_handle_t handle, httpd_method_t method, const char *uri,
+                             const char *headers, const char *body, host_httpd_response_t *resp)
+{
+    host_httpd_t *server = handle;
+    httpd_uri_match_func_t match = server->config.uri_match_fn;
+
+    memset(resp, 0, sizeof(*resp));
+    for (int i = 0; i < server->handlers_num; i++) {
+        const httpd_uri_t *h = &server->handlers[i];
+        bool hit = match ? match(h->uri, uri, strlen(uri)) : !strcmp(h->uri, uri);
+        if (!hit || (int)h->method != (int)method) {
+            continue;
+        }
+
+        httpd_req_t req = {
+            .handle = handle,
+            .method = method,
+            .content_len = body ? strlen(body) : 0,
+            .user_ctx = h->user_ctx,
+        };
+        strlcpy((char *)req.uri, uri, sizeof(req.uri));
+        host_httpd_aux_t aux = { .req_headers = headers, .body = body, .resp = resp };
+        req.aux = &aux;
+
+        esp_err_t err = h->handler(&req);
+        if (req.free_ctx && req.sess_ctx) {
+            req.free_ctx(req.sess_ctx);
+        }
+        return err;
+    }
+    resp->status = 404;
+    return ESP_ERR_NOT_FOUND;
+}
+
+void host_httpd_response_free(host_httpd_response_t *resp)
+{
+    __real_free(resp->body);
+    resp->body = NULL;
+    resp->body_len = 0;
+}
@@ -0,0 +1,145 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "esp_partition.h"
+
+/*
+ * Raw data partitions from partitions.csv. NVS and SPIFFS have their own
+ * stand-ins in storage.c and are not listed. Contents start erased, or
+ * with an image file as if it had been flashed, and are lost on exit.
+ */
+
+#ifndef HOST_WWW_BLOB
+#define HOST_WWW_BLOB NULL
+#endif
+
+#define HOST_FLASH_ERASE_US 45000 /* typical 4 KiB sector erase, ESP32-C3 datasheet */
+
+typedef struct {
+    esp_partition_t part;
+    uint8_t *data;
+    const char *image;
+} host_partition_t;
+
+static host_partition_t partitions[] = {
+    { .part = { .type = ESP_PARTITION_TYPE_DATA, .subtype = 0x40, .address = 0x310000, .size = 512 * 1024,
+                .label = "history" } },
+    { .part = { .type = ESP_PARTITION_TYPE_DATA, .subtype = 0x41, .address = 0x390000, .size = 256 * 1024,
+                .label = "www" },
+      .image = HOST_WWW_BLOB },
+};
+static pthread_mutex_t flash_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static host_partition_t *lookup(const esp_partition_t *partition)
+{
+    for (size_t i = 0; i < sizeof(partitions) / sizeof(*partitions); i++) {
+        if (&partitions[i].part == partition) {
+            return &partitions[i];
+        }
+    }
+    return NULL;
+}
+
+static void load_image(host_partition_t *p)
+{
+    FILE *fp = p->image ? fopen(p->image, "rb") : NULL;
+    if (!fp) {
+        return;
+    }
+    if (fread(p->data, 1, p->part.size, fp) == p->part.size && fgetc(fp) != EOF) {
+        fprintf(stderr, "%s: larger than the %s partition, truncated\n", p->image, p->part.label);
+    }
+    fclose(fp);
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    pthread_mutex_lock(&flash_lock);
+    const esp_partition_t *found = NULL;
+    for (size_t i = 0; !found && i < sizeof(partitions) / sizeof(*partitions); i++) {
+        host_partition_t *p = &partitions[i];
+        if (p->part.type != type || (subtype != ESP_PARTITION_SUBTYPE_ANY && p->part.subtype != subtype) ||
+            (label && strcmp(p->part.label, label))) {
+            continue;
+        }
+        if (!p->data) {
+            /* Flash, not heap: keep it out of the --wrap'ed allocator. */
+            p->data = mmap(NULL, p->part.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            memset(p->data, 0xFF, p->part.size);
+            load_image(p);
+        }
+        found = &p->part;
+    }
+    pthread_mutex_unlock(&flash_lock);
+    return found;
+}
+
+static host_partition_t *check_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    host_partition_t *p = lookup(partition);
+    if (!p || offset > p->part.size || size > p->part.size - offset) {
+        return NULL;
+    }
+    return p;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    host_partition_t *p = check_range(partition, src_offset, size);
+    if (!p) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&flash_lock);
+    memcpy(dst, p->data + src_offset, size);
+    pthread_mutex_unlock(&flash_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    host_partition_t *p = check_range(partition, dst_offset, size);
+    if (!p) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&flash_lock);
+    const uint8_t *in = src;
+    for (size_t i = 0; i < size; i++) {
+        p->data[dst_offset + i] &= in[i];
+    }
+    pthread_mutex_unlock(&flash_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    host_partition_t *p = check_range(partition, offset, size);
+    if (!p || offset % SPI_FLASH_SEC_SIZE || size % SPI_FLASH_SEC_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    usleep(HOST_FLASH_ERASE_US * (size / SPI_FLASH_SEC_SIZE));
+    pthread_mutex_lock(&flash_lock);
+    memset(p->data + offset, 0xFF, size);
+    pthread_mutex_unlock(&flash_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+                             spi_flash_mmap_memory_t memory, const void **out_ptr,
+                             spi_flash_mmap_handle_t *out_handle)
+{
+    host_partition_t *p = check_range(partition, offset, size);
+    if (!p) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_ptr = p->data + offset;
+    *out_handle = 0;
+    return ESP_OK;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle)
+{
+}
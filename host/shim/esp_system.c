@@ -0,0 +1,233 @@
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_chip_info.h"
+#include "esp_timer.h"
+#include "host_shim.h"
+
+/* The badge has ~320 KiB of RAM; report free heap relative to that. */
+#define HOST_HEAP_SIZE (320 * 1024)
+
+static atomic_uint_fast64_t heap_mallocs;
+static atomic_uint_fast64_t heap_frees;
+static atomic_uint_fast64_t heap_bytes;
+static atomic_int_fast64_t heap_in_use;
+
+/* ------------------------------------------------------------------ heap -- */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size)
+{
+    atomic_fetch_add(&heap_mallocs, 1);
+    atomic_fetch_add(&heap_bytes, size);
+    void *ptr = __real_malloc(size);
+    atomic_fetch_add(&heap_in_use, malloc_usable_size(ptr));
+    return ptr;
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+    atomic_fetch_add(&heap_mallocs, 1);
+    atomic_fetch_add(&heap_bytes, nmemb * size);
+    void *ptr = __real_calloc(nmemb, size);
+    atomic_fetch_add(&heap_in_use, malloc_usable_size(ptr));
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    if (ptr == NULL) {
+        atomic_fetch_add(&heap_mallocs, 1);
+    }
+    atomic_fetch_add(&heap_bytes, size);
+    atomic_fetch_sub(&heap_in_use, malloc_usable_size(ptr));
+    ptr = __real_realloc(ptr, size);
+    atomic_fetch_add(&heap_in_use, malloc_usable_size(ptr));
+    return ptr;
+}
+
+void __wrap_free(void *ptr)
+{
+    if (ptr != NULL) {
+        atomic_fetch_add(&heap_frees, 1);
+        atomic_fetch_sub(&heap_in_use, malloc_usable_size(ptr));
+    }
+    __real_free(ptr);
+}
+
+void host_heap_stats_get(host_heap_stats_t *out)
+{
+    out->mallocs = atomic_load(&heap_mallocs);
+    out->frees = atomic_load(&heap_frees);
+    out->bytes = atomic_load(&heap_bytes);
+}
+
+void host_heap_stats_reset(void)
+{
+    atomic_store(&heap_mallocs, 0);
+    atomic_store(&heap_frees, 0);
+    atomic_store(&heap_bytes, 0);
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    return malloc(size);
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    int64_t used = atomic_load(&heap_in_use);
+    if (used < 0) {
+        used = 0;   /* frees of blocks libc allocated before main() */
+    }
+    return used >= HOST_HEAP_SIZE ? 0 : (uint32_t)(HOST_HEAP_SIZE - used);
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return esp_get_free_heap_size();
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return esp_get_free_heap_size();
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    return esp_get_free_heap_size();
+}
+
+/* ------------------------------------------------------------------- log -- */
+
+static esp_log_level_t log_level = ESP_LOG_INFO;
+static pthread_once_t log_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void log_level_from_env(void)
+{
+    const char *env = getenv("BADGE_HOST_LOG");
+    if (env) {
+        log_level = (esp_log_level_t)atoi(env);
+    }
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    /* Per-tag levels are not modelled; only "*" changes the global level. */
+    pthread_once(&log_once, log_level_from_env);
+    if (tag && !strcmp(tag, "*")) {
+        log_level = level;
+    }
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    va_list args;
+
+    pthread_once(&log_once, log_level_from_env);
+    if (level > log_level) {
+        return;
+    }
+    pthread_mutex_lock(&log_lock);
+    fprintf(stderr, "%c (%lu) %s: ", letters[level], (unsigned long)(esp_timer_get_time() / 1000), tag);
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+    pthread_mutex_unlock(&log_lock);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+/* ---------------------------------------------------------------- system -- */
+
+uint32_t esp_random(void)
+{
+    uint32_t value;
+    if (getrandom(&value, sizeof(value), 0) != sizeof(value)) {
+        value = (uint32_t)rand();
+    }
+    return value;
+}
+
+void esp_fill_random(void *buf, size_t len)
+{
+    uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = getrandom(p, len, 0);
+        if (n <= 0) {
+            break;
+        }
+        p += n;
+        len -= n;
+    }
+}
+
+void esp_restart(void)
+{
+    ESP_LOGW("host", "esp_restart() called, exiting");
+    exit(0);
+}
+
+esp_err_t esp_efuse_mac_get_default(uint8_t *mac)
+{
+    static const uint8_t host_mac[6] = {0x34, 0x85, 0x18, 0x00, 0xba, 0xd9};
+    memcpy(mac, host_mac, sizeof(host_mac));
+    return ESP_OK;
+}
+
+void esp_chip_info(esp_chip_info_t *out_info)
+{
+    memset(out_info, 0, sizeof(*out_info));
+    out_info->cores = 1;
+}
+
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size) {
+        size_t n = len >= size ? size - 1 : len;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+
+size_t strlcat(char *dst, const char *src, size_t size)
+{
+    size_t dlen = strnlen(dst, size);
+    if (dlen == size) {
+        return size + strlen(src);
+    }
+    return dlen + strlcpy(dst + dlen, src, size - dlen);
+}
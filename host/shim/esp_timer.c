@@ -0,0 +1,161 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "esp_timer.h"
+
+/*
+ * Each esp_timer gets its own dispatcher thread. The badge runs callbacks
+ * from a single esp_timer task, so callbacks here must be just as short.
+ */
+
+struct host_esp_timer {
+    esp_timer_create_args_t args;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int64_t deadline_us;    /* 0 when idle */
+    uint64_t period_us;     /* 0 for one-shot */
+    bool quit;
+};
+
+int64_t esp_timer_get_time(void)
+{
+    static int64_t boot_us;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t now = (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+    if (boot_us == 0) {
+        boot_us = now;
+    }
+    return now - boot_us;
+}
+
+static void *timer_thread(void *arg)
+{
+    struct host_esp_timer *t = arg;
+
+    pthread_mutex_lock(&t->lock);
+    while (!t->quit) {
+        if (t->deadline_us == 0) {
+            pthread_cond_wait(&t->changed, &t->lock);
+            continue;
+        }
+        int64_t now = esp_timer_get_time();
+        if (now < t->deadline_us) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            int64_t wait = t->deadline_us - now;
+            ts.tv_sec += wait / 1000000LL;
+            ts.tv_nsec += (wait % 1000000LL) * 1000;
+            if (ts.tv_nsec >= 1000000000L) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&t->changed, &t->lock, &ts);
+            continue;
+        }
+        t->deadline_us = t->period_us ? t->deadline_us + (int64_t)t->period_us : 0;
+        pthread_mutex_unlock(&t->lock);
+        t->args.callback(t->args.arg);
+        pthread_mutex_lock(&t->lock);
+    }
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    if (!args || !args->callback || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct host_esp_timer *t = calloc(1, sizeof(*t));
+    if (!t) {
+        return ESP_ERR_NO_MEM;
+    }
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&t->changed, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&t->lock, NULL);
+    t->args = *args;
+    if (pthread_create(&t->thread, NULL, timer_thread, t) != 0) {
+        free(t);
+        return ESP_ERR_NO_MEM;
+    }
+    *out_handle = t;
+    return ESP_OK;
+}
+
+static esp_err_t timer_arm(esp_timer_handle_t t, uint64_t timeout_us, uint64_t period_us)
+{
+    if (!t) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&t->lock);
+    if (t->deadline_us != 0) {
+        pthread_mutex_unlock(&t->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    t->deadline_us = esp_timer_get_time() + (int64_t)timeout_us;
+    /* A zero timeout must still fire, so never leave the "idle" marker behind. */
+    if (t->deadline_us == 0) {
+        t->deadline_us = 1;
+    }
+    t->period_us = period_us;
+    pthread_cond_signal(&t->changed);
+    pthread_mutex_unlock(&t->lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_arm(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return timer_arm(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t)
+{
+    if (!t) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&t->lock);
+    esp_err_t err = t->deadline_us ? ESP_OK : ESP_ERR_INVALID_STATE;
+    t->deadline_us = 0;
+    t->period_us = 0;
+    pthread_cond_signal(&t->changed);
+    pthread_mutex_unlock(&t->lock);
+    return err;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t t)
+{
+    if (!t) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&t->lock);
+    t->quit = true;
+    pthread_cond_signal(&t->changed);
+    pthread_mutex_unlock(&t->lock);
+    if (!pthread_equal(pthread_self(), t->thread)) {
+        pthread_join(t->thread, NULL);
+        free(t);
+    } else {
+        pthread_detach(t->thread);
+    }
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t t)
+{
+    pthread_mutex_lock(&t->lock);
+    bool active = t->deadline_us != 0;
+    pthread_mutex_unlock(&t->lock);
+    return active;
+}
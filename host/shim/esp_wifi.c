@@ -0,0 +1,353 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+#include "esp_log.h"
+
+/*
+ * WiFi driver, netif and default event loop stand-ins. The driver only
+ * tracks state and enforces the same init/start ordering as the real one;
+ * STA connects succeed after a short delay and hand out a fixed lease.
+ */
+
+#define EVENT_HANDLERS_MAX  16
+#define EVENT_DATA_MAX      64
+#define STA_CONNECT_DELAY_MS 50
+
+/* Rough driver costs, so host runs show which calls a mode switch makes.
+ * Not measured on a badge. */
+#define WIFI_INIT_US    40000
+#define WIFI_DEINIT_US  20000
+#define WIFI_START_US   25000
+#define WIFI_STOP_US    15000
+#define WIFI_IF_US      10000   /* an interface brought up or down by set_mode */
+
+esp_event_base_t WIFI_EVENT = "WIFI_EVENT";
+esp_event_base_t IP_EVENT = "IP_EVENT";
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void *arg;
+} event_handler_entry_t;
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    size_t size;
+    uint8_t data[EVENT_DATA_MAX];
+} event_msg_t;
+
+struct host_netif {
+    const char *key;
+    const char *desc;
+    esp_netif_ip_info_t ip_info;
+};
+
+static event_handler_entry_t handlers[EVENT_HANDLERS_MAX];
+static int handlers_num = 0;
+static pthread_mutex_t handlers_lock = PTHREAD_MUTEX_INITIALIZER;
+static QueueHandle_t event_queue;
+
+static esp_netif_t netif_sta = { .key = "WIFI_STA_DEF", .desc = "sta" };
+static esp_netif_t netif_ap = { .key = "WIFI_AP_DEF", .desc = "ap" };
+
+static bool wifi_inited = false;
+static bool wifi_started = false;
+static wifi_mode_t wifi_mode = WIFI_MODE_NULL;
+static atomic_uint wifi_tx_frames;
+
+/* ---------------------------------------------------------------- events -- */
+
+static void event_task(void *arg)
+{
+    event_msg_t msg;
+    while (1) {
+        if (xQueueReceive(event_queue, &msg, portMAX_DELAY) != pdPASS) {
+            continue;
+        }
+        event_handler_entry_t snapshot[EVENT_HANDLERS_MAX];
+        pthread_mutex_lock(&handlers_lock);
+        int num = handlers_num;
+        memcpy(snapshot, handlers, sizeof(handlers));
+        pthread_mutex_unlock(&handlers_lock);
+
+        for (int i = 0; i < num; i++) {
+            if (snapshot[i].base == msg.base &&
+                (snapshot[i].id == ESP_EVENT_ANY_ID || snapshot[i].id == msg.id)) {
+                snapshot[i].handler(snapshot[i].arg, msg.base, msg.id, msg.size ? msg.data : NULL);
+            }
+        }
+    }
+}
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    if (event_queue) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    event_queue = xQueueCreate(32, sizeof(event_msg_t));
+    xTaskCreate(event_task, "sys_evt", 2304, NULL, 20, NULL);
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id,
+                                     esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    pthread_mutex_lock(&handlers_lock);
+    if (handlers_num == EVENT_HANDLERS_MAX) {
+        pthread_mutex_unlock(&handlers_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    handlers[handlers_num++] = (event_handler_entry_t) {
+        .base = event_base, .id = event_id, .handler = event_handler, .arg = event_handler_arg
+    };
+    pthread_mutex_unlock(&handlers_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id,
+                         const void *event_data, size_t event_data_size, TickType_t ticks_to_wait)
+{
+    if (!event_queue) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (event_data_size > EVENT_DATA_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    event_msg_t msg = { .base = event_base, .id = event_id, .size = event_data_size };
+    if (event_data_size) {
+        memcpy(msg.data, event_data, event_data_size);
+    }
+    return xQueueSend(event_queue, &msg, ticks_to_wait) == pdPASS ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+/* ----------------------------------------------------------------- netif -- */
+
+esp_err_t esp_netif_init(void)
+{
+    return ESP_OK;
+}
+
+esp_netif_t *esp_netif_create_default_wifi_ap(void)
+{
+    netif_ap.ip_info.ip.addr = 0x0104a8c0;      /* 192.168.4.1 */
+    netif_ap.ip_info.gw.addr = 0x0104a8c0;
+    netif_ap.ip_info.netmask.addr = 0x00ffffff;
+    return &netif_ap;
+}
+
+esp_netif_t *esp_netif_create_default_wifi_sta(void)
+{
+    return &netif_sta;
+}
+
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *if_key)
+{
+    if (!strcmp(if_key, netif_sta.key)) {
+        return &netif_sta;
+    }
+    if (!strcmp(if_key, netif_ap.key)) {
+        return &netif_ap;
+    }
+    return NULL;
+}
+
+esp_netif_t *esp_netif_next(esp_netif_t *netif)
+{
+    if (netif == NULL) {
+        return &netif_sta;
+    }
+    return netif == &netif_sta ? &netif_ap : NULL;
+}
+
+const char *esp_netif_get_desc(esp_netif_t *netif)
+{
+    return netif->desc;
+}
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t *netif, esp_netif_ip_info_t *ip_info)
+{
+    *ip_info = netif->ip_info;
+    return ESP_OK;
+}
+
+/* ------------------------------------------------------------------ wifi -- */
+
+#define WIFI_CHECK_INIT() do { if (!wifi_inited) return ESP_ERR_WIFI_NOT_INIT; } while (0)
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+    /* Like the real driver, a second init without deinit is harmless. */
+    if (!wifi_inited) {
+        usleep(WIFI_INIT_US);
+    }
+    wifi_inited = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_deinit(void)
+{
+    if (wifi_started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    WIFI_CHECK_INIT();
+    usleep(WIFI_DEINIT_US);
+    wifi_inited = false;
+    return ESP_OK;
+}
+
+static bool mode_has_sta(wifi_mode_t mode)
+{
+    return mode == WIFI_MODE_STA || mode == WIFI_MODE_APSTA;
+}
+
+static bool mode_has_ap(wifi_mode_t mode)
+{
+    return mode == WIFI_MODE_AP || mode == WIFI_MODE_APSTA;
+}
+
+/* While started, interfaces come and go with the mode like on the badge. */
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+    WIFI_CHECK_INIT();
+    if (wifi_started) {
+        if (mode_has_sta(wifi_mode) != mode_has_sta(mode)) {
+            usleep(WIFI_IF_US);
+            esp_event_post(WIFI_EVENT, mode_has_sta(mode) ? WIFI_EVENT_STA_START : WIFI_EVENT_STA_STOP, NULL, 0, 0);
+        }
+        if (mode_has_ap(wifi_mode) != mode_has_ap(mode)) {
+            usleep(WIFI_IF_US);
+            esp_event_post(WIFI_EVENT, mode_has_ap(mode) ? WIFI_EVENT_AP_START : WIFI_EVENT_AP_STOP, NULL, 0, 0);
+        }
+        if (!mode_has_sta(mode)) {
+            netif_sta.ip_info = (esp_netif_ip_info_t) { 0 };
+        }
+    }
+    wifi_mode = mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mode(wifi_mode_t *mode)
+{
+    WIFI_CHECK_INIT();
+    *mode = wifi_mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    WIFI_CHECK_INIT();
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage)
+{
+    WIFI_CHECK_INIT();
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void)
+{
+    WIFI_CHECK_INIT();
+    usleep(WIFI_START_US);
+    wifi_started = true;
+    if (mode_has_sta(wifi_mode)) {
+        esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_START, NULL, 0, 0);
+    }
+    if (mode_has_ap(wifi_mode)) {
+        esp_event_post(WIFI_EVENT, WIFI_EVENT_AP_START, NULL, 0, 0);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_stop(void)
+{
+    WIFI_CHECK_INIT();
+    if (wifi_started) {
+        usleep(WIFI_STOP_US);
+    }
+    if (wifi_started && mode_has_sta(wifi_mode)) {
+        esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_STOP, NULL, 0, 0);
+    }
+    wifi_started = false;
+    netif_sta.ip_info = (esp_netif_ip_info_t) { 0 };
+    return ESP_OK;
+}
+
+static void sta_connect_task(void *arg)
+{
+    vTaskDelay(pdMS_TO_TICKS(STA_CONNECT_DELAY_MS));
+    wifi_event_sta_connected_t connected = { .channel = 6 };
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, &connected, sizeof(connected), 0);
+
+    netif_sta.ip_info.ip.addr = 0x6401a8c0;     /* 192.168.1.100 */
+    netif_sta.ip_info.gw.addr = 0x0101a8c0;
+    netif_sta.ip_info.netmask.addr = 0x00ffffff;
+    ip_event_got_ip_t got_ip = { .esp_netif = &netif_sta, .ip_info = netif_sta.ip_info };
+    esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, &got_ip, sizeof(got_ip), 0);
+    vTaskDelete(NULL);
+}
+
+esp_err_t esp_wifi_connect(void)
+{
+    WIFI_CHECK_INIT();
+    if (!wifi_started) {
+        return ESP_ERR_WIFI_NOT_STARTED;
+    }
+    xTaskCreate(sta_connect_task, "sta_connect", 2048, NULL, 5, NULL);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_disconnect(void)
+{
+    WIFI_CHECK_INIT();
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second)
+{
+    WIFI_CHECK_INIT();
+    return primary >= 1 && primary <= 14 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_wifi_set_promiscuous(bool en)
+{
+    WIFI_CHECK_INIT();
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_inactive_time(wifi_interface_t ifx, uint16_t sec)
+{
+    WIFI_CHECK_INIT();
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info)
+{
+    WIFI_CHECK_INIT();
+    memset(ap_info, 0, sizeof(*ap_info));
+    ap_info->primary = 6;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_80211_tx(wifi_interface_t ifx, const void *buffer, int len, bool en_sys_seq)
+{
+    WIFI_CHECK_INIT();
+    if (!wifi_started) {
+        return ESP_ERR_WIFI_NOT_STARTED;
+    }
+    if (len < 24 || len > 1500) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    atomic_fetch_add(&wifi_tx_frames, 1);
+    return ESP_OK;
+}
@@ -0,0 +1,456 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+
+struct host_task {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    char name[16];
+    int stats; // index in task_stats, -1 if full
+};
+
+/* Per task name, kept after the task is gone. */
+#define TASK_STATS_MAX 32
+static struct {
+    char name[16];
+    uint64_t wakeups;
+} task_stats[TASK_STATS_MAX];
+static int task_stats_count;
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    uint8_t *storage;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+struct host_event_group {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    EventBits_t bits;
+};
+
+static pthread_mutex_t critical_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static __thread struct host_task *current_task;
+
+void host_critical_enter(void)
+{
+    pthread_mutex_lock(&critical_lock);
+}
+
+void host_critical_exit(void)
+{
+    pthread_mutex_unlock(&critical_lock);
+}
+
+static uint64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/* Absolute CLOCK_MONOTONIC deadline `ticks` from now, for pthread_cond_timedwait. */
+static void deadline_from_ticks(TickType_t ticks, struct timespec *ts)
+{
+    uint64_t us = (uint64_t)pdTICKS_TO_MS(ticks) * 1000ULL;
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += us / 1000000ULL;
+    ts->tv_nsec += (us % 1000000ULL) * 1000;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static void cond_init_monotonic(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+/* Counts the times the current task comes back from blocking. */
+static void count_wakeup(void)
+{
+    if (current_task && current_task->stats >= 0) {
+        __atomic_fetch_add(&task_stats[current_task->stats].wakeups, 1, __ATOMIC_RELAXED);
+    }
+}
+
+uint64_t host_task_wakeups(const char *name)
+{
+    uint64_t total = 0;
+    host_critical_enter();
+    for (int i = 0; i < task_stats_count; i++) {
+        if (!strcmp(task_stats[i].name, name)) {
+            total += task_stats[i].wakeups;
+        }
+    }
+    host_critical_exit();
+    return total;
+}
+
+/* Wait on `cond` until signalled or the tick deadline passes; false on timeout. */
+static bool cond_wait_ticks(pthread_cond_t *cond, pthread_mutex_t *lock,
+                            TickType_t ticks, const struct timespec *deadline)
+{
+    if (ticks == 0) {
+        return false;
+    }
+    count_wakeup();
+    if (ticks == portMAX_DELAY) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+/* ----------------------------------------------------------------- tasks -- */
+
+static void *task_trampoline(void *arg)
+{
+    struct host_task *task = arg;
+    current_task = task;
+    task->fn(task->arg);
+    /* FreeRTOS tasks must not return; treat it like vTaskDelete(NULL). */
+    free(task);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                                   void *arg, UBaseType_t prio, TaskHandle_t *handle, BaseType_t core)
+{
+    struct host_task *task = calloc(1, sizeof(*task));
+    if (!task) {
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    strncpy(task->name, name ? name : "task", sizeof(task->name) - 1);
+    host_critical_enter();
+    task->stats = -1;
+    for (int i = 0; i < task_stats_count; i++) {
+        if (!strcmp(task_stats[i].name, task->name)) {
+            task->stats = i;
+        }
+    }
+    if (task->stats < 0 && task_stats_count < TASK_STATS_MAX) {
+        task->stats = task_stats_count++;
+        strcpy(task_stats[task->stats].name, task->name);
+    }
+    host_critical_exit();
+
+    if (pthread_create(&task->thread, NULL, task_trampoline, task) != 0) {
+        free(task);
+        return pdFAIL;
+    }
+    pthread_setname_np(task->thread, task->name);
+    pthread_detach(task->thread);
+    if (handle) {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                       void *arg, UBaseType_t prio, TaskHandle_t *handle)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, arg, prio, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t handle)
+{
+    if (handle == NULL || handle == current_task) {
+        struct host_task *self = current_task;
+        current_task = NULL;
+        free(self);
+        pthread_exit(NULL);
+    }
+    pthread_cancel(handle->thread);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return current_task;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    uint64_t us = (uint64_t)pdTICKS_TO_MS(ticks) * 1000ULL;
+    struct timespec ts = { .tv_sec = us / 1000000ULL, .tv_nsec = (us % 1000000ULL) * 1000 };
+    /* vTaskDelay(0) is a yield in FreeRTOS. */
+    if (ticks == 0) {
+        sched_yield();
+        return;
+    }
+    count_wakeup();
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(monotonic_us() / (1000000ULL / configTICK_RATE_HZ));
+}
+
+/* ---------------------------------------------------------------- queues -- */
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    struct host_queue *q = calloc(1, sizeof(*q));
+    if (!q) {
+        return NULL;
+    }
+    q->length = length;
+    q->item_size = item_size;
+    if (item_size) {
+        q->storage = calloc(length, item_size);
+        if (!q->storage) {
+            free(q);
+            return NULL;
+        }
+    }
+    pthread_mutex_init(&q->lock, NULL);
+    cond_init_monotonic(&q->not_empty);
+    cond_init_monotonic(&q->not_full);
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+    if (!q) {
+        return;
+    }
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+    free(q->storage);
+    free(q);
+}
+
+static BaseType_t queue_put(QueueHandle_t q, const void *item, TickType_t ticks, bool front)
+{
+    struct timespec deadline;
+    deadline_from_ticks(ticks, &deadline);
+
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->length) {
+        if (!cond_wait_ticks(&q->not_full, &q->lock, ticks, &deadline)) {
+            pthread_mutex_unlock(&q->lock);
+            return errQUEUE_FULL;
+        }
+    }
+    if (q->item_size) {
+        UBaseType_t slot;
+        if (front) {
+            q->head = (q->head + q->length - 1) % q->length;
+            slot = q->head;
+        } else {
+            slot = (q->head + q->count) % q->length;
+        }
+        memcpy(q->storage + slot * q->item_size, item, q->item_size);
+    }
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+static BaseType_t queue_get(QueueHandle_t q, void *item, TickType_t ticks, bool peek)
+{
+    struct timespec deadline;
+    deadline_from_ticks(ticks, &deadline);
+
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0) {
+        if (!cond_wait_ticks(&q->not_empty, &q->lock, ticks, &deadline)) {
+            pthread_mutex_unlock(&q->lock);
+            return errQUEUE_EMPTY;
+        }
+    }
+    if (q->item_size && item) {
+        memcpy(item, q->storage + q->head * q->item_size, q->item_size);
+    }
+    if (!peek) {
+        q->head = (q->head + 1) % q->length;
+        q->count--;
+        pthread_cond_signal(&q->not_full);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    return queue_put(q, item, ticks, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    return queue_put(q, item, ticks, true);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t q, const void *item)
+{
+    pthread_mutex_lock(&q->lock);
+    q->head = 0;
+    q->count = 0;
+    pthread_mutex_unlock(&q->lock);
+    return queue_put(q, item, 0, false);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    return queue_get(q, item, ticks, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    return queue_get(q, item, ticks, true);
+}
+
+BaseType_t xQueueReset(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    q->head = 0;
+    q->count = 0;
+    pthread_cond_broadcast(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t count = q->count;
+    pthread_mutex_unlock(&q->lock);
+    return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q)
+{
+    return q->length - uxQueueMessagesWaiting(q);
+}
+
+/* ------------------------------------------------------------ semaphores -- */
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    QueueHandle_t q = xQueueCreate(max, 0);
+    if (q) {
+        q->count = initial;
+    }
+    return q;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    return queue_get(sem, NULL, ticks, false);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return queue_put(sem, NULL, 0, false);
+}
+
+/* ---------------------------------------------------------- event groups -- */
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    struct host_event_group *g = calloc(1, sizeof(*g));
+    if (!g) {
+        return NULL;
+    }
+    pthread_mutex_init(&g->lock, NULL);
+    cond_init_monotonic(&g->changed);
+    return g;
+}
+
+void vEventGroupDelete(EventGroupHandle_t g)
+{
+    if (!g) {
+        return;
+    }
+    pthread_mutex_destroy(&g->lock);
+    pthread_cond_destroy(&g->changed);
+    free(g);
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t g, EventBits_t bits)
+{
+    pthread_mutex_lock(&g->lock);
+    g->bits |= bits;
+    EventBits_t now = g->bits;
+    pthread_cond_broadcast(&g->changed);
+    pthread_mutex_unlock(&g->lock);
+    return now;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t g, EventBits_t bits)
+{
+    pthread_mutex_lock(&g->lock);
+    EventBits_t before = g->bits;
+    g->bits &= ~bits;
+    pthread_mutex_unlock(&g->lock);
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t g)
+{
+    pthread_mutex_lock(&g->lock);
+    EventBits_t bits = g->bits;
+    pthread_mutex_unlock(&g->lock);
+    return bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t g, EventBits_t bits, BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t ticks)
+{
+    struct timespec deadline;
+    deadline_from_ticks(ticks, &deadline);
+
+    pthread_mutex_lock(&g->lock);
+    for (;;) {
+        EventBits_t hit = g->bits & bits;
+        if (wait_for_all ? (hit == bits) : (hit != 0)) {
+            break;
+        }
+        if (!cond_wait_ticks(&g->changed, &g->lock, ticks, &deadline)) {
+            break;
+        }
+    }
+    EventBits_t result = g->bits;
+    EventBits_t hit = result & bits;
+    if (clear_on_exit && (wait_for_all ? (hit == bits) : (hit != 0))) {
+        g->bits &= ~bits;
+    }
+    pthread_mutex_unlock(&g->lock);
+    return result;
+}
@@ -0,0 +1,13 @@
+#ifndef __HOST_DRIVER_RMT_H__
+#define __HOST_DRIVER_RMT_H__
+
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+typedef enum {
+    RMT_CHANNEL_0,
+    RMT_CHANNEL_1,
+    RMT_CHANNEL_MAX
+} rmt_channel_t;
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef __HOST_ESP_BT_H__
+#define __HOST_ESP_BT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef enum {
+    ESP_BT_MODE_IDLE       = 0x00,
+    ESP_BT_MODE_BLE        = 0x01,
+    ESP_BT_MODE_CLASSIC_BT = 0x02,
+    ESP_BT_MODE_BTDM       = 0x03,
+} esp_bt_mode_t;
+
+typedef struct {
+    uint16_t controller_task_stack_size;
+    uint8_t controller_task_prio;
+} esp_bt_controller_config_t;
+
+#define BT_CONTROLLER_INIT_CONFIG_DEFAULT() { \
+    .controller_task_stack_size = 4096,       \
+    .controller_task_prio = 23,               \
+}
+
+typedef struct esp_vhci_host_callback {
+    void (*notify_host_send_available)(void);
+    int (*notify_host_recv)(uint8_t *data, uint16_t len);
+} esp_vhci_host_callback_t;
+
+esp_err_t esp_bt_controller_mem_release(esp_bt_mode_t mode);
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t *cfg);
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode);
+
+esp_err_t esp_vhci_host_register_callback(const esp_vhci_host_callback_t *callback);
+bool esp_vhci_host_check_send_available(void);
+void esp_vhci_host_send_packet(uint8_t *data, uint16_t len);
+
+#endif
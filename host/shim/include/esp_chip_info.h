@@ -0,0 +1,15 @@
+#ifndef __HOST_ESP_CHIP_INFO_H__
+#define __HOST_ESP_CHIP_INFO_H__
+
+#include <stdint.h>
+
+typedef struct {
+    int model;
+    uint32_t features;
+    uint16_t revision;
+    uint8_t cores;
+} esp_chip_info_t;
+
+void esp_chip_info(esp_chip_info_t *out_info);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef __HOST_ESP_MAC_H__
+#define __HOST_ESP_MAC_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define MAC2STR(a) (a)[0], (a)[1], (a)[2], (a)[3], (a)[4], (a)[5]
+#define MACSTR "%02x:%02x:%02x:%02x:%02x:%02x"
+
+esp_err_t esp_efuse_mac_get_default(uint8_t *mac);
+
+#endif
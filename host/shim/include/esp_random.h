@@ -0,0 +1,10 @@
+#ifndef __HOST_ESP_RANDOM_H__
+#define __HOST_ESP_RANDOM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+uint32_t esp_random(void);
+void esp_fill_random(void *buf, size_t len);
+
+#endif
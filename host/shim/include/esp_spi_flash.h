@@ -0,0 +1,18 @@
+#ifndef __HOST_ESP_SPI_FLASH_H__
+#define __HOST_ESP_SPI_FLASH_H__
+
+#include <stdint.h>
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef enum {
+    SPI_FLASH_MMAP_DATA,
+    SPI_FLASH_MMAP_INST,
+} spi_flash_mmap_memory_t;
+
+typedef uint32_t spi_flash_mmap_handle_t;
+
+/* Mappings are the partition contents themselves, nothing to release. */
+void spi_flash_munmap(spi_flash_mmap_handle_t handle);
+
+#endif
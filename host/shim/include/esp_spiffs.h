@@ -0,0 +1,22 @@
+#ifndef __HOST_ESP_SPIFFS_H__
+#define __HOST_ESP_SPIFFS_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+typedef struct {
+    const char *base_path;
+    const char *partition_label;
+    size_t max_files;
+    bool format_if_mount_failed;
+} esp_vfs_spiffs_conf_t;
+
+/*
+ * On the host the partition is a temporary directory seeded from the
+ * repository's data/ folder; paths below base_path are redirected there.
+ */
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t *conf);
+esp_err_t esp_spiffs_info(const char *partition_label, size_t *total_bytes, size_t *used_bytes);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef __HOST_ESP_SYSTEM_H__
+#define __HOST_ESP_SYSTEM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "esp_err.h"
+#include "esp_random.h"
+#include "esp_heap_caps.h"
+
+#ifndef IDF_VER
+#define IDF_VER "host"
+#endif
+
+void esp_restart(void) __attribute__((noreturn));
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
+
+/* glibc before 2.38 ships without the BSD string helpers newlib provides. */
+size_t strlcpy(char *dst, const char *src, size_t size);
+size_t strlcat(char *dst, const char *src, size_t size);
+
+#endif
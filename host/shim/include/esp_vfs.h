@@ -0,0 +1,10 @@
+#ifndef __HOST_ESP_VFS_H__
+#define __HOST_ESP_VFS_H__
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define ESP_VFS_PATH_MAX 15
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef __HOST_FREERTOS_H__
+#define __HOST_FREERTOS_H__
+
+/*
+ * Host stand-in for the FreeRTOS kernel API used by the badge firmware.
+ * Tasks are pthreads, the tick is derived from CLOCK_MONOTONIC and runs at
+ * the same rate as CONFIG_FREERTOS_HZ on the badge (100 Hz).
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#define configTICK_RATE_HZ          100
+#define CONFIG_FREERTOS_HZ          configTICK_RATE_HZ
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t StackType_t;
+
+#define portMAX_DELAY               ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS          ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS            portTICK_PERIOD_MS
+
+#define pdFALSE                     ((BaseType_t)0)
+#define pdTRUE                      ((BaseType_t)1)
+#define pdPASS                      pdTRUE
+#define pdFAIL                      pdFALSE
+#define errQUEUE_EMPTY              ((BaseType_t)0)
+#define errQUEUE_FULL               ((BaseType_t)0)
+
+#define pdMS_TO_TICKS(xTimeInMs)    ((TickType_t)(((uint64_t)(xTimeInMs) * configTICK_RATE_HZ) / 1000U))
+#define pdTICKS_TO_MS(xTicks)       ((TickType_t)(((uint64_t)(xTicks) * 1000U) / configTICK_RATE_HZ))
+
+#define tskNO_AFFINITY              0x7FFFFFFF
+
+#define portENTER_CRITICAL(mux)     host_critical_enter()
+#define portEXIT_CRITICAL(mux)      host_critical_exit()
+#define portMUX_INITIALIZER_UNLOCKED 0
+typedef int portMUX_TYPE;
+
+#define portYIELD_FROM_ISR(x)       ((void)(x))
+
+void host_critical_enter(void);
+void host_critical_exit(void);
+
+#endif
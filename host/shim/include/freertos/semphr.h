@@ -0,0 +1,19 @@
+#ifndef __HOST_FREERTOS_SEMPHR_H__
+#define __HOST_FREERTOS_SEMPHR_H__
+
+#include "freertos/queue.h"
+
+/* Semaphores are zero-sized queues, as they are in FreeRTOS itself. */
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+#define vSemaphoreDelete(s)             vQueueDelete(s)
+#define xSemaphoreGiveFromISR(s, w)     xSemaphoreGive(s)
+#define xSemaphoreTakeFromISR(s, w)     xSemaphoreTake(s, 0)
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef __HOST_SHIM_H__
+#define __HOST_SHIM_H__
+
+/*
+ * Host-only hooks into the ESP-IDF stand-ins. Nothing in main/ includes
+ * this header; it is used by the host runner to drive and observe the
+ * firmware logic.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+/* Heap accounting, fed by the --wrap'ed allocator entry points. */
+typedef struct {
+    uint64_t mallocs;   /* malloc/calloc/realloc(NULL, n) calls */
+    uint64_t frees;     /* free() calls with a non-NULL pointer */
+    uint64_t bytes;     /* bytes requested in total */
+} host_heap_stats_t;
+
+void host_heap_stats_get(host_heap_stats_t *out);
+void host_heap_stats_reset(void);
+
+/* Deliver a raw H4 packet to the registered VHCI host callback. Advertising
+ * reports go through the controller's scan state first: they are dropped
+ * while scanning is off, and repeats of an address while duplicate
+ * filtering is on. */
+int host_vhci_inject(uint8_t *data, uint16_t len);
+
+/* Deliver a packet as recorded from a real controller, skipping the scan
+ * state model. */
+int host_vhci_deliver(uint8_t *data, uint16_t len);
+
+/* Build a single-report HCI LE Advertising Report event, returns its length. */
+uint16_t host_vhci_make_adv_report(uint8_t *buf, size_t size, const uint8_t addr[6],
+                                   int8_t rssi, const uint8_t *adv_data, uint8_t adv_len);
+
+/* Number of HCI commands the firmware has sent to the emulated controller. */
+uint32_t host_vhci_commands_sent(void);
+
+/* Advertising reports the emulated controller held back (scan off or duplicate). */
+uint32_t host_vhci_filtered(void);
+
+/* Times tasks called `name` returned from a blocking FreeRTOS call. */
+uint64_t host_task_wakeups(const char *name);
+
+/* Directory that stands in for the SPIFFS partition mounted at /data. */
+const char *host_spiffs_root(void);
+
+typedef struct {
+    int status;                 /* HTTP status code */
+    char type[64];              /* Content-Type */
+    char headers[512];          /* extra headers, "Name: value\r\n" each */
+    char *body;
+    size_t body_len;
+    size_t chunks;              /* httpd_resp_send_chunk() calls with data */
+} host_httpd_response_t;
+
+/*
+ * Run one request through the handler registered for `uri`. `headers` uses
+ * the same "Name: value\r\n" layout as the response and may be NULL.
+ */
+esp_err_t host_httpd_request(httpd_handle_t server, httpd_method_t method, const char *uri,
+                             const char *headers, const char *body, host_httpd_response_t *resp);
+void host_httpd_response_free(host_httpd_response_t *resp);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef __HOST_LVGL_H__
+#define __HOST_LVGL_H__
+
+/* Opaque LVGL types so ui.h can be included; ui.c is not built on the host. */
+
+typedef struct _lv_obj_t lv_obj_t;
+typedef struct _lv_task_t lv_task_t;
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef __HOST_LVGL_HELPERS_H__
+#define __HOST_LVGL_HELPERS_H__
+
+#include "lvgl.h"
+
+#endif
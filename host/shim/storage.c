@@ -0,0 +1,277 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "esp_spiffs.h"
+#include "esp_log.h"
+#include "nvs_flash.h"
+#include "host_shim.h"
+
+/*
+ * SPIFFS and NVS stand-ins. The partition mounted at base_path lives in a
+ * temporary directory seeded from HOST_SPIFFS_SEED_DIR (the repo's data/),
+ * or in $BADGE_HOST_SPIFFS when set so state survives between runs. File
+ * calls are linked with --wrap so absolute "/data/..." paths used by the
+ * firmware resolve into that directory.
+ */
+
+#define TAG "host_storage"
+#define NVS_HANDLES_MAX 8
+
+static char spiffs_base[32];
+static char spiffs_root[PATH_MAX];
+static bool spiffs_tmp = false;
+static char nvs_namespaces[NVS_HANDLES_MAX][16];
+
+const char *host_spiffs_root(void)
+{
+    return spiffs_root;
+}
+
+/* Rewrite `path` into `buf` when it lives below the mounted base path. */
+static const char *redirect(const char *path, char *buf, size_t size)
+{
+    size_t base_len = strlen(spiffs_base);
+    if (!path || !base_len || strncmp(path, spiffs_base, base_len) ||
+        (path[base_len] != '/' && path[base_len] != '\0')) {
+        return path;
+    }
+    snprintf(buf, size, "%s%s", spiffs_root, path + base_len);
+    return buf;
+}
+
+FILE *__real_fopen(const char *path, const char *mode);
+int __real_open(const char *path, int flags, ...);
+int __real_stat(const char *path, struct stat *st);
+int __real_unlink(const char *path);
+int __real_rename(const char *from, const char *to);
+DIR *__real_opendir(const char *path);
+
+FILE *__wrap_fopen(const char *path, const char *mode)
+{
+    char buf[PATH_MAX];
+    return __real_fopen(redirect(path, buf, sizeof(buf)), mode);
+}
+
+int __wrap_open(const char *path, int flags, ...)
+{
+    char buf[PATH_MAX];
+    mode_t mode = 0;
+    if (flags & O_CREAT) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+    return __real_open(redirect(path, buf, sizeof(buf)), flags, mode);
+}
+
+int __wrap_stat(const char *path, struct stat *st)
+{
+    char buf[PATH_MAX];
+    return __real_stat(redirect(path, buf, sizeof(buf)), st);
+}
+
+int __wrap_unlink(const char *path)
+{
+    char buf[PATH_MAX];
+    return __real_unlink(redirect(path, buf, sizeof(buf)));
+}
+
+int __wrap_rename(const char *from, const char *to)
+{
+    char buf_from[PATH_MAX], buf_to[PATH_MAX];
+    return __real_rename(redirect(from, buf_from, sizeof(buf_from)), redirect(to, buf_to, sizeof(buf_to)));
+}
+
+DIR *__wrap_opendir(const char *path)
+{
+    char buf[PATH_MAX];
+    return __real_opendir(redirect(path, buf, sizeof(buf)));
+}
+
+/* ---------------------------------------------------------------- spiffs -- */
+
+static const char *seed_src;
+
+static int seed_copy(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+    char dst[PATH_MAX];
+    snprintf(dst, sizeof(dst), "%s%s", spiffs_root, path + strlen(seed_src));
+    if (type == FTW_D) {
+        mkdir(dst, 0755);
+        return 0;
+    }
+    if (type != FTW_F) {
+        return 0;
+    }
+    FILE *in = __real_fopen(path, "rb");
+    FILE *out = __real_fopen(dst, "wb");
+    if (in && out) {
+        char chunk[4096];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+            fwrite(chunk, 1, n, out);
+        }
+    }
+    if (in) fclose(in);
+    if (out) fclose(out);
+    return 0;
+}
+
+static int remove_entry(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+    return remove(path);
+}
+
+static void spiffs_cleanup(void)
+{
+    if (spiffs_tmp) {
+        nftw(spiffs_root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+}
+
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t *conf)
+{
+    if (spiffs_base[0]) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const char *env = getenv("BADGE_HOST_SPIFFS");
+    if (env) {
+        snprintf(spiffs_root, sizeof(spiffs_root), "%s", env);
+        mkdir(spiffs_root, 0755);
+    } else {
+        snprintf(spiffs_root, sizeof(spiffs_root), "/tmp/badge-spiffs-XXXXXX");
+        if (!mkdtemp(spiffs_root)) {
+            return ESP_FAIL;
+        }
+        spiffs_tmp = true;
+        atexit(spiffs_cleanup);
+#ifdef HOST_SPIFFS_SEED_DIR
+        seed_src = HOST_SPIFFS_SEED_DIR;
+        nftw(seed_src, seed_copy, 16, FTW_PHYS);
+#endif
+    }
+    snprintf(spiffs_base, sizeof(spiffs_base), "%s", conf->base_path);
+    ESP_LOGI(TAG, "%s mounted from %s", spiffs_base, spiffs_root);
+    return ESP_OK;
+}
+
+static size_t used_bytes_acc;
+
+static int used_bytes_add(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+    if (type == FTW_F) {
+        used_bytes_acc += st->st_size;
+    }
+    return 0;
+}
+
+esp_err_t esp_spiffs_info(const char *partition_label, size_t *total_bytes, size_t *used_bytes)
+{
+    used_bytes_acc = 0;
+    nftw(spiffs_root, used_bytes_add, 16, FTW_PHYS);
+    *total_bytes = 1024 * 1024;
+    *used_bytes = used_bytes_acc;
+    return ESP_OK;
+}
+
+/* ------------------------------------------------------------------- nvs -- */
+
+static void nvs_key_path(nvs_handle_t handle, const char *key, char *buf, size_t size)
+{
+    if (snprintf(buf, size, "%s/.nvs/%s.%s", spiffs_root, nvs_namespaces[handle - 1], key) >= (int)size) {
+        buf[0] = '\0'; /* fails to open rather than hitting another key */
+    }
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (!spiffs_root[0]) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    char dir[PATH_MAX];
+    if (snprintf(dir, sizeof(dir), "%s/.nvs", spiffs_root) >= (int)sizeof(dir)) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    mkdir(dir, 0755);
+    for (int i = 0; i < NVS_HANDLES_MAX; i++) {
+        if (!nvs_namespaces[i][0] || !strcmp(nvs_namespaces[i], name)) {
+            snprintf(nvs_namespaces[i], sizeof(nvs_namespaces[i]), "%s", name);
+            *out_handle = i + 1;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    char path[PATH_MAX];
+    nvs_key_path(handle, key, path, sizeof(path));
+    FILE *fp = __real_fopen(path, "rb");
+    if (!fp) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    fseek(fp, 0, SEEK_END);
+    size_t size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (out_value == NULL) {
+        *length = size;
+        fclose(fp);
+        return ESP_OK;
+    }
+    if (*length < size) {
+        fclose(fp);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *length = fread(out_value, 1, size, fp);
+    fclose(fp);
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    char path[PATH_MAX];
+    nvs_key_path(handle, key, path, sizeof(path));
+    FILE *fp = __real_fopen(path, "wb");
+    if (!fp) {
+        return ESP_FAIL;
+    }
+    fwrite(value, 1, length, fp);
+    fclose(fp);
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    char path[PATH_MAX];
+    nvs_key_path(handle, key, path, sizeof(path));
+    return __real_unlink(path) == 0 ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_OK;
+}
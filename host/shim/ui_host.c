@@ -0,0 +1,32 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#include "badge/ui.h"
+
+/* ui.c needs the display and LVGL drivers; the host runs without a screen. */
+
+void ui_task(void *arg)
+{
+    ESP_LOGI(__FILE__, "No display on host, UI task idle");
+    vTaskDelete(NULL);
+}
+
+void button_task(void *arg)
+{
+    vTaskDelete(NULL);
+}
+
+void ui_connection_progress(uint8_t cur, uint8_t max)
+{
+    ESP_LOGI(__FILE__, "Connecting (%d/%d)", cur, max);
+}
+
+void ui_wifi_radio_done(int state, bool ok)
+{
+    ESP_LOGI(__FILE__, "WiFi radio settled in state %d%s", state, ok ? "" : " (failed)");
+}
+
+void ui_toggle_sync()
+{
+}
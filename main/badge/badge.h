@@ -16,6 +16,8 @@
 #include "wifi.h"
 #include "httpd.h"
 #include "sync.h"
+#include "history.h"
+#include "www.h"
 #include "ui.h"
 
 #define SETTINGS_FILE "/data/settings.json"
@@ -27,7 +29,10 @@
 #define BADGE_NAME_MAX_SIZE 28
 #define SCHEDULE_BUFFER_LEN 10000
 
-#define MAX_NEARBY_NODE 16
+// Size of the nearby node table, override with -DMAX_NEARBY_NODE=n
+#ifndef MAX_NEARBY_NODE
+#define MAX_NEARBY_NODE 64
+#endif
 #define SIZEOF(a) sizeof(a)/sizeof(*a)
 
 // These variables are autogenerated and compiled
@@ -61,29 +66,42 @@ typedef struct {
 } badge_obj_t;
 
 typedef struct {
+    uint8_t addr[6];
     char name[BADGE_NAME_MAX_SIZE];
     uint8_t id;
-    short rssi;
+    short rssi; // smoothed
+    uint8_t bucket; // BLE_BUCKET_NEAR/MID/FAR
+    uint16_t name_hash;
     uint32_t last_found;
     bool active;
 } ble_node_t;
 
+typedef struct {
+    char name[BADGE_NAME_MAX_SIZE];
+    short rssi;
+    uint8_t id;
+} ble_radar_node_t;
+
 enum enum_badge_event {
     EVENT_HOTSPOT_START, 
     EVENT_HOTSPOT_STOP, 
     EVENT_MARAUDER_START, 
     EVENT_MARAUDER_STOP, 
+    EVENT_STA_START,
+    EVENT_STA_STOP,
 };
 
-extern QueueHandle_t wifi_queue;
-extern ble_node_t ble_nodes[MAX_NEARBY_NODE];
 extern badge_obj_t badge_obj;
 
 void badge_init();
 char* load_file_content(char* filename);
-char* load_schedule_from_file();
 
-uint8_t count_ble_nodes();
+uint16_t count_ble_nodes();
+// Copy of up to `max` nearby nodes sorted by distance bucket (nearest first), taken
+// without locking. Returns the number of nodes copied.
+size_t ble_nodes_snapshot(ble_node_t *out, size_t max);
+// The same, only the fields /radar shows.
+size_t ble_nodes_radar(ble_radar_node_t *out, size_t max);
 bool check_ble_set();
 
 #endif // _DRAGON_H
@@ -1,3 +1,9 @@
+#include <inttypes.h>
+#include <stdatomic.h>
+
+#include "esp_timer.h"
+#include "lib8tion.h"
+
 #include "bt.h"
 
 typedef struct {
@@ -6,36 +12,381 @@ typedef struct {
 } ble_scan_local_name_t;
 
 typedef struct {
-    uint8_t *q_data;
-    uint16_t q_data_len;
+    uint8_t slot;
+    uint16_t q_data_len;  // 0 for a Command Complete, which uses no slot
+    uint16_t opcode;
+    uint8_t status;
 } host_rcv_data_t;
 
+/* One step of an HCI command sequence run by bt_task. */
+typedef struct {
+    const char *name;
+    uint16_t opcode;
+    void (*send)(void);
+} hci_cmd_step_t;
+
 static uint8_t hci_cmd_buf[128];
 
 static uint16_t scanned_count = 0;
 static QueueHandle_t adv_queue;
 
+/*
+ * HCI packets are copied by the controller callback into one of these
+ * slots. Free slot indexes wait in pkt_free_queue, filled ones travel to
+ * bt_task through adv_queue and come back once parsed.
+ */
+static uint8_t pkt_pool[BT_PKT_POOL_SLOTS][BT_PKT_SLOT_SIZE];
+static QueueHandle_t pkt_free_queue;
+static bt_pkt_pool_stats_t pkt_stats;
+
+/*
+ * HCI capture: while a file is open bt_task appends every packet it takes
+ * off adv_queue as a little-endian uint16 length followed by the packet,
+ * and host_rcv_pkt stops rejecting non-badge traffic so the file holds
+ * what the controller delivered. capture_lock serialises bt_task with
+ * bt_capture_start/stop called from other tasks.
+ */
+static FILE * volatile capture_fp = NULL;
+static uint32_t capture_bytes;
+static uint32_t capture_max;
+static SemaphoreHandle_t capture_lock;
+
+/*
+ * ble_nodes is a pool of slots. node_hash maps a BD address to its slot + 1
+ * (open addressing with linear probing, 0 is empty) and node_order lists
+ * the used slots sorted by distance bucket, nearest first; node_rank is the
+ * reverse map. rssi_level is the RSSI filter state, dBm + 128. All zeroes
+ * is a valid empty table.
+ */
+#define NODE_HASH_SIZE (2 * MAX_NEARBY_NODE)
+#define NODE_EMPTY 0
+
+static ble_node_t ble_nodes[MAX_NEARBY_NODE];
+static uint16_t node_hash[NODE_HASH_SIZE];
+static uint16_t node_order[MAX_NEARBY_NODE];
+static uint16_t node_rank[MAX_NEARBY_NODE];
+static uint8_t rssi_level[MAX_NEARBY_NODE];
+static uint32_t history_tick[MAX_NEARBY_NODE]; // last sighting logged
+static uint16_t node_count = 0;
+static uint16_t node_free[MAX_NEARBY_NODE];
+static uint16_t node_free_count = 0;
+static uint16_t node_unused = 0; // slots from here on were never handed out
+static uint32_t node_joins = 0;
+
+/*
+ * Expiry deadlines of the used slots as a binary min-heap, so bt_task only
+ * looks at the nodes that are due and knows how long it may sleep.
+ * heap_pos is the index of a slot in expiry_heap. The heap holds exactly
+ * node_count slots.
+ */
+static uint16_t expiry_heap[MAX_NEARBY_NODE];
+static uint16_t heap_pos[MAX_NEARBY_NODE];
+static bt_node_stats_t node_stats;
+
+/*
+ * Other tasks never read the table above. bt_task publishes a sorted copy
+ * after each change under a sequence counter (seqlock): it is odd while
+ * the copy is rewritten, and readers retry if it was odd or moved while
+ * they were copying. Readers never block the scanner.
+ */
+static atomic_uint nodes_seq;
+static EventBits_t nodes_events = 0; // for subscribers, sent on publish
+static bool set_complete = false;
+static _Atomic(EventGroupHandle_t) event_subscribers[BLE_EVENT_SUBSCRIBERS_MAX];
+static atomic_int event_subscriber_count; // slots taken, may briefly run past the max
+static struct {
+    uint16_t count;
+    uint8_t id_bits;
+    ble_node_t nodes[MAX_NEARBY_NODE];
+} nodes_pub;
+static bool nodes_dirty = false;
+
+static void publish_nodes()
+{
+    unsigned seq = atomic_load_explicit(&nodes_seq, memory_order_relaxed);
+    uint8_t id_bits = 0;
+
+    atomic_store_explicit(&nodes_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for(int i=0; i<node_count; i++) {
+        nodes_pub.nodes[i] = ble_nodes[node_order[i]];
+        id_bits |= 1 << (nodes_pub.nodes[i].id-1);
+    }
+    nodes_pub.count = node_count;
+    nodes_pub.id_bits = id_bits;
+    atomic_store_explicit(&nodes_seq, seq + 2, memory_order_release);
+    nodes_dirty = false;
+    node_stats.publishes++;
+
+    bool complete = (id_bits | 1 << (badge_obj.device_id-1)) == 0x7F;
+    if (complete != set_complete) {
+        set_complete = complete;
+        nodes_events |= complete ? BLE_EVENT_SET_COMPLETE : BLE_EVENT_SET_BROKEN;
+    }
+    if (nodes_events) {
+        int subscribers = atomic_load(&event_subscriber_count);
+        for (int i = 0; i < subscribers && i < BLE_EVENT_SUBSCRIBERS_MAX; i++) {
+            /* A slot is taken before its group is stored. */
+            EventGroupHandle_t group = atomic_load(&event_subscribers[i]);
+            if (group) {
+                xEventGroupSetBits(group, nodes_events);
+            }
+        }
+        nodes_events = 0;
+    }
+}
+
+EventGroupHandle_t ble_events_subscribe()
+{
+    EventGroupHandle_t group = xEventGroupCreate();
+    if (group == NULL) {
+        return NULL;
+    }
+    int i = atomic_fetch_add(&event_subscriber_count, 1);
+    if (i >= BLE_EVENT_SUBSCRIBERS_MAX) {
+        atomic_fetch_sub(&event_subscriber_count, 1);
+        vEventGroupDelete(group);
+        ESP_LOGE(__FILE__, "Too many BLE event subscribers");
+        return NULL;
+    }
+    atomic_store(&event_subscribers[i], group);
+    return group;
+}
+
+/* Start of a read of nodes_pub, waits out a publish in progress. */
+static unsigned nodes_read_begin()
+{
+    unsigned seq;
+    /* bt_task may be preempted by us mid-publish, let it finish. */
+    while ((seq = atomic_load_explicit(&nodes_seq, memory_order_acquire)) & 1) {
+        vTaskDelay(1);
+    }
+    return seq;
+}
+
+/* True if bt_task published while we read, the copy must be taken again. */
+static bool nodes_read_retry(unsigned seq)
+{
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&nodes_seq, memory_order_relaxed) != seq;
+}
+
+/* Copies up to `max` published nodes, returns the number copied. The
+ * published node count and id bits are stored if asked for. */
+static size_t read_nodes(ble_node_t *out, size_t max, uint16_t *count, uint8_t *id_bits)
+{
+    unsigned seq;
+    uint16_t pub_count;
+    uint8_t pub_id_bits;
+    size_t n;
+    do {
+        seq = nodes_read_begin();
+        pub_count = nodes_pub.count;
+        pub_id_bits = nodes_pub.id_bits;
+        n = pub_count < max ? pub_count : max;
+        if (n > 0) {
+            memcpy(out, nodes_pub.nodes, n * sizeof(ble_node_t));
+        }
+    } while (nodes_read_retry(seq));
+    if (count) *count = pub_count;
+    if (id_bits) *id_bits = pub_id_bits;
+    return n;
+}
+
+size_t ble_nodes_snapshot(ble_node_t *out, size_t max)
+{
+    return read_nodes(out, max, NULL, NULL);
+}
+
+size_t ble_nodes_radar(ble_radar_node_t *out, size_t max)
+{
+    unsigned seq;
+    size_t n;
+    do {
+        seq = nodes_read_begin();
+        n = nodes_pub.count < max ? nodes_pub.count : max;
+        for (size_t i = 0; i < n; i++) {
+            const ble_node_t *node = &nodes_pub.nodes[i];
+            memcpy(out[i].name, node->name, sizeof(out[i].name));
+            out[i].rssi = node->rssi;
+            out[i].id = node->id;
+        }
+    } while (nodes_read_retry(seq));
+    return n;
+}
+
+uint16_t count_ble_nodes(){
+    uint16_t count;
+    read_nodes(NULL, 0, &count, NULL);
+    return count;
+}
+
+bool check_ble_set()
+{   
+    uint8_t set_bits = 0;
+    read_nodes(NULL, 0, NULL, &set_bits);
+    set_bits |= 1 << (badge_obj.device_id-1);
+    return set_bits == 0x7F;
+}
+
 static void init_ble_nodes() {
     for(int i=0; i<MAX_NEARBY_NODE; i++) {
         ble_nodes[i].name[0] = '\0';
         ble_nodes[i].active = false;
     }
+    for(int i=0; i<NODE_HASH_SIZE; i++) {
+        node_hash[i] = NODE_EMPTY;
+    }
+    node_free_count = 0;
+    node_unused = 0;
+    node_count = 0;
+    publish_nodes();
+}
+
+static uint16_t hash_addr(const uint8_t *addr)
+{
+    /* FNV-1a */
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < BD_ADDR_LEN; i++) {
+        h ^= addr[i];
+        h *= 16777619u;
+    }
+    return h % NODE_HASH_SIZE;
 }
 
-static int check_duplicate(const ble_node_t* item) {
-    // ESP_LOGI(__FILE__, "STRCMP result: %d", strcmp(ble_nodes[0].name, item->name));
-    for(int i = 0; i < MAX_NEARBY_NODE; i++) {
-        if(!strcmp(ble_nodes[i].name, item->name)) // same name - avoid duplicates
-        {
-            return i;
+static int find_node(const uint8_t *addr)
+{
+    for (uint16_t h = hash_addr(addr); node_hash[h] != NODE_EMPTY; h = (h + 1) % NODE_HASH_SIZE) {
+        if (!memcmp(ble_nodes[node_hash[h] - 1].addr, addr, BD_ADDR_LEN)) {
+            return node_hash[h] - 1;
         }
     }
     return -1;
 }
 
+static void hash_insert(uint16_t slot)
+{
+    uint16_t h = hash_addr(ble_nodes[slot].addr);
+    while (node_hash[h] != NODE_EMPTY) {
+        h = (h + 1) % NODE_HASH_SIZE;
+    }
+    node_hash[h] = slot + 1;
+}
+
+static void hash_remove(uint16_t slot)
+{
+    uint16_t i = hash_addr(ble_nodes[slot].addr);
+    while (node_hash[i] != slot + 1) {
+        i = (i + 1) % NODE_HASH_SIZE;
+    }
+    node_hash[i] = NODE_EMPTY;
+
+    /* Shift back the entries of the probe run that follows the hole so
+     * lookups never stop early (no tombstones). */
+    for (uint16_t j = (i + 1) % NODE_HASH_SIZE; node_hash[j] != NODE_EMPTY; j = (j + 1) % NODE_HASH_SIZE) {
+        uint16_t k = hash_addr(ble_nodes[node_hash[j] - 1].addr);
+        bool in_place = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if (!in_place) {
+            node_hash[i] = node_hash[j];
+            node_hash[j] = NODE_EMPTY;
+            i = j;
+        }
+    }
+}
+
+static void order_set(uint16_t rank, uint16_t slot)
+{
+    node_order[rank] = slot;
+    node_rank[slot] = rank;
+}
+
+/* Move the node at `rank` up or down until node_order is sorted again. */
+static void order_fix(uint16_t rank)
+{
+    uint16_t slot = node_order[rank];
+    uint8_t bucket = ble_nodes[slot].bucket;
+
+    while (rank > 0 && ble_nodes[node_order[rank - 1]].bucket > bucket) {
+        order_set(rank, node_order[rank - 1]);
+        rank--;
+    }
+    while (rank + 1 < node_count && ble_nodes[node_order[rank + 1]].bucket < bucket) {
+        order_set(rank, node_order[rank + 1]);
+        rank++;
+    }
+    order_set(rank, slot);
+}
+
+static uint32_t node_deadline(uint16_t slot)
+{
+    return ble_nodes[slot].last_found + pdMS_TO_TICKS(NODE_QUEUE_TIMEOUT_MS);
+}
+
+/* Tick counts wrap, compare them by their difference. */
+static bool deadline_before(uint16_t a, uint16_t b)
+{
+    return (int32_t)(node_deadline(a) - node_deadline(b)) < 0;
+}
+
+static void heap_set(uint16_t pos, uint16_t slot)
+{
+    expiry_heap[pos] = slot;
+    heap_pos[slot] = pos;
+}
+
+static void heap_fix(uint16_t pos, uint16_t size)
+{
+    uint16_t slot = expiry_heap[pos];
+    while (pos > 0 && deadline_before(slot, expiry_heap[(pos - 1) / 2])) {
+        heap_set(pos, expiry_heap[(pos - 1) / 2]);
+        pos = (pos - 1) / 2;
+    }
+    while (2 * pos + 1 < size) {
+        uint16_t child = 2 * pos + 1;
+        if (child + 1 < size && deadline_before(expiry_heap[child + 1], expiry_heap[child])) {
+            child++;
+        }
+        if (!deadline_before(expiry_heap[child], slot)) break;
+        heap_set(pos, expiry_heap[child]);
+        pos = child;
+    }
+    heap_set(pos, slot);
+}
+
+/* Called before node_count drops. */
+static void heap_remove(uint16_t slot)
+{
+    uint16_t pos = heap_pos[slot];
+    uint16_t last = expiry_heap[node_count - 1];
+    if (last != slot) {
+        heap_set(pos, last);
+        heap_fix(pos, node_count - 1);
+    }
+}
+
+static void remove_node(uint16_t slot)
+{
+    ESP_LOGI(__FILE__, "Removing node %s", ble_nodes[slot].name);
+    hash_remove(slot);
+    heap_remove(slot);
+    for (uint16_t rank = node_rank[slot]; rank + 1 < node_count; rank++) {
+        order_set(rank, node_order[rank + 1]);
+    }
+    node_count--;
+    nodes_events |= BLE_EVENT_NODE_LEFT;
+    ble_nodes[slot].active = false;
+    ble_nodes[slot].name[0] = '\0';
+    node_free[node_free_count++] = slot;
+    nodes_dirty = true;
+}
+
 static int set_node_data(const char* local_name, const short rssi, ble_node_t* item) {
-    if (sscanf(local_name, "[%hhu] %28s", &(item->id), item->name) == 2)
+    /* "[id] name", the name is taken as sent (spaces and all) so that it
+     * hashes the same as the badge_adv_t name_hash of its sender. */
+    int prefix = 0;
+    if (sscanf(local_name, "[%hhu]%n", &(item->id), &prefix) == 1 && local_name[prefix] == ' ')
     {
+        strlcpy(item->name, &local_name[prefix + 1], sizeof(item->name));
         if (item->id > 0 && item->id < 8){
             item->rssi = rssi;
             item->active = true;
@@ -46,53 +397,171 @@ static int set_node_data(const char* local_name, const short rssi, ble_node_t* i
     return -1;
 }
 
-static void sort_nodes(){
-    for(int i=0; i< MAX_NEARBY_NODE-1; i++){
-        if((ble_nodes[i].rssi < ble_nodes[i+1].rssi) && ble_nodes[i+1].active)
-        {
-            ble_node_t tmp = ble_nodes[i];
-            ble_nodes[i] = ble_nodes[i+1];
-            ble_nodes[i+1] = tmp;
+static void expire_nodes(uint32_t now) {
+    while (node_count > 0) {
+        uint16_t slot = expiry_heap[0];
+        int32_t late = (int32_t)(now - node_deadline(slot));
+        if (late < 0) break;
+        ESP_LOGI(__FILE__, "Disabling node %s for inactivity", ble_nodes[slot].name);
+        uint32_t jitter_ms = pdTICKS_TO_MS(late);
+        node_stats.expired++;
+        node_stats.jitter_total_ms += jitter_ms;
+        if (jitter_ms > node_stats.jitter_max_ms) {
+            node_stats.jitter_max_ms = jitter_ms;
         }
+        remove_node(slot);
+    }
+    if(nodes_dirty) publish_nodes();
+}
+
+/* Ticks until the next node expires, portMAX_DELAY with an empty table. */
+static uint32_t next_expiry(uint32_t now)
+{
+    if (node_count == 0) return portMAX_DELAY;
+    int32_t left = (int32_t)(node_deadline(expiry_heap[0]) - now);
+    return left > 0 ? left : 0;
+}
+
+void bt_get_node_stats(bt_node_stats_t *stats)
+{
+    *stats = node_stats;
+}
+
+static uint8_t rssi_bucket(short rssi)
+{
+    if (rssi >= BLE_RSSI_NEAR) return BLE_BUCKET_NEAR;
+    if (rssi >= BLE_RSSI_MID) return BLE_BUCKET_MID;
+    return BLE_BUCKET_FAR;
+}
+
+/* A node leaves its bucket only once it is clearly past the boundary. */
+static uint8_t rssi_bucket_hysteresis(short rssi, uint8_t current)
+{
+    uint8_t bucket = rssi_bucket(rssi);
+    if (bucket < current) {
+        bucket = rssi_bucket(rssi - BLE_RSSI_HYSTERESIS);
+    } else if (bucket > current) {
+        bucket = rssi_bucket(rssi + BLE_RSSI_HYSTERESIS);
     }
+    return bucket;
+}
+
+static uint8_t rssi_to_level(short rssi)
+{
+    return rssi < -128 ? 0 : rssi > 127 ? 255 : rssi + 128;
 }
 
-static void disable_nodes(uint32_t now) {
-    for(int i = 0; i < MAX_NEARBY_NODE; i++) {
-        if(!ble_nodes[i].active) continue; // Ignore if already disabled
-        if(pdTICKS_TO_MS(now - ble_nodes[i].last_found) > NODE_QUEUE_TIMEOUT_MS){
-            ESP_LOGI(__FILE__, "Disabling node %s for inactivity", ble_nodes[i].name);
-            ble_nodes[i].active = false;
-            ble_nodes[i].name[0] = '\0';
+/* level += alpha * (sample - level), weights summing to 256 with scale8. */
+static short rssi_filter(uint16_t slot, short rssi)
+{
+    rssi_level[slot] = qadd8(scale8(rssi_level[slot], 255 - BLE_RSSI_EWMA_ALPHA),
+                             scale8(rssi_to_level(rssi), BLE_RSSI_EWMA_ALPHA - 1));
+    return (short)rssi_level[slot] - 128;
+}
+
+static void log_sighting(uint16_t slot)
+{
+    const ble_node_t *node = &ble_nodes[slot];
+    history_log(node->addr, node->id, node->name_hash, node->rssi);
+    history_tick[slot] = node->last_found;
+}
+
+/*
+ * Only joins, leaves, bucket changes and renames reorder and publish the
+ * table. Other updates just refresh the RSSI and deadline in place; they
+ * reach the other tasks with the next publish.
+ */
+static void update_node(int slot, const ble_node_t *item){
+    node_stats.updates++;
+    if(slot < 0){ // New address
+        if(node_count == MAX_NEARBY_NODE) {
+            /* Table full: the new node only replaces a weaker one. Buckets
+             * have hysteresis and aren't sorted inside, so look at them all. */
+            uint16_t weakest = node_order[0];
+            for (uint16_t rank = 1; rank < node_count; rank++) {
+                if (ble_nodes[node_order[rank]].rssi < ble_nodes[weakest].rssi) {
+                    weakest = node_order[rank];
+                }
+            }
+            if(item->rssi <= ble_nodes[weakest].rssi) return;
+            remove_node(weakest);
         }
+        ESP_LOGI(__FILE__, "Node %s is new (insert & sort)", item->name);
+        node_joins++;
+        nodes_events |= BLE_EVENT_NODE_JOINED;
+        slot = node_free_count ? node_free[--node_free_count] : node_unused++;
+        ble_nodes[slot] = *item;
+        ble_nodes[slot].bucket = rssi_bucket(item->rssi);
+        rssi_level[slot] = rssi_to_level(item->rssi);
+        hash_insert(slot);
+        heap_set(node_count, slot);
+        order_set(node_count++, slot);
+        heap_fix(heap_pos[slot], node_count);
+        order_fix(node_rank[slot]);
+        nodes_dirty = true;
+        log_sighting(slot);
+        return;
+    }
+
+    // Already known
+    ble_node_t *node = &ble_nodes[slot];
+    if (node->id != item->id || node->name_hash != item->name_hash || strcmp(node->name, item->name)) {
+        ESP_LOGI(__FILE__, "Node %s in slot %d renamed to %s", node->name, slot, item->name);
+        node->id = item->id;
+        node->name_hash = item->name_hash;
+        memcpy(node->name, item->name, sizeof(node->name));
+        nodes_dirty = true;
+    }
+    node->rssi = rssi_filter(slot, item->rssi);
+    node->last_found = item->last_found;
+    heap_fix(heap_pos[slot], node_count);
+
+    uint8_t bucket = rssi_bucket_hysteresis(node->rssi, node->bucket);
+    if (bucket != node->bucket) {
+        ESP_LOGI(__FILE__, "Node %s in slot %d moved to bucket %d (%d dBm)", node->name, slot, bucket, node->rssi);
+        node->bucket = bucket;
+        node_stats.bucket_changes++;
+        nodes_events |= BLE_EVENT_RSSI_BUCKET;
+        order_fix(node_rank[slot]);
+        nodes_dirty = true;
+        log_sighting(slot);
+    } else if (node->last_found - history_tick[slot] >= pdMS_TO_TICKS(HISTORY_SIGHTING_MS)) {
+        log_sighting(slot);
     }
 }
 
-static void insert(const char* local_name, uint8_t name_len, short rssi){
+static void insert(const uint8_t *addr, const char* local_name, uint8_t name_len, short rssi){
     if((name_len-4) > BADGE_BUF_SIZE) return;
 
     ble_node_t item;
     int res = set_node_data(local_name, rssi, &item);
     if(!res){
-        ESP_LOGI(__FILE__, "[BLE node] id: %d |name: %s (%d bytes) | rssi: %d", item.id, item.name, strlen(item.name), item.rssi);
-        int pos = check_duplicate(&item);
-        if(pos < 0){ // No duplicates
-            ESP_LOGI(__FILE__, "Node %s is new (insert & sort)", item.name);
-            for(int i=0; i < MAX_NEARBY_NODE; i++) {
-                if((item.rssi > ble_nodes[i].rssi) || !ble_nodes[i].active)
-                {
-                    ble_node_t tmp = ble_nodes[i];
-                    ble_nodes[i] = item;
-                    item = tmp;
-                }
-            }
-        } else { // Duplicate
-            ESP_LOGI(__FILE__, "Node %s already in pos %d (update & sort)", item.name, pos);
-            ble_nodes[pos] = item;
+        memcpy(item.addr, addr, BD_ADDR_LEN);
+        item.name_hash = badge_name_hash(item.name);
+        ESP_LOGI(__FILE__, "[BLE node] id: %d |name: %s (%zu bytes) | rssi: %d", item.id, item.name, strlen(item.name), item.rssi);
+        update_node(find_node(addr), &item);
+    }
+}
 
-            sort_nodes();
-        }
+/* Badge advertisement: the name only comes with the scan response, keep the
+ * one we have unless the hash says the badge was renamed. */
+static void insert_badge_adv(const uint8_t *addr, const badge_adv_t *adv, short rssi){
+    if(adv->id < 1 || adv->id > 7) return;
+
+    ble_node_t item;
+    int slot = find_node(addr);
+    if(slot >= 0 && ble_nodes[slot].name_hash == adv->name_hash) {
+        memcpy(item.name, ble_nodes[slot].name, sizeof(item.name));
+    } else {
+        item.name[0] = '\0';
     }
+    memcpy(item.addr, addr, BD_ADDR_LEN);
+    item.id = adv->id;
+    item.rssi = rssi;
+    item.name_hash = adv->name_hash;
+    item.last_found = xTaskGetTickCount();
+    item.active = true;
+    update_node(slot, &item);
 }
 
 static void controller_rcv_pkt_ready(void)
@@ -107,37 +576,108 @@ static void controller_rcv_pkt_ready(void)
 static int host_rcv_pkt(uint8_t *data, uint16_t len)
 {
     host_rcv_data_t send_data;
-    uint8_t *data_pkt;
     /* Check second byte for HCI event. If event opcode is 0x0e, the event is
-     * HCI Command Complete event. Sice we have recieved "0x0e" event, we can
-     * check for byte 4 for command opcode and byte 6 for it's return status. */
-    if (data[1] == 0x0e) {
-        if (data[6] == 0) {
-            ESP_LOGI(__FILE__, "Event opcode 0x%02x success.", data[4]);
-        } else {
-            ESP_LOGE(__FILE__, "Event opcode 0x%02x fail with reason: 0x%02x.", data[4], data[6]);
-            return ESP_FAIL;
-        }
+     * HCI Command Complete event. Bytes 4-5 hold the command opcode and byte
+     * 6 its return status; hand them to bt_task to send the next command. */
+    if (len >= 7 && data[1] == 0x0e) {
+        send_data.q_data_len = 0;
+        send_data.opcode = data[4] | (data[5] << 8);
+        send_data.status = data[6];
+        xQueueSend(adv_queue, (void *)&send_data, ( TickType_t ) 0);
+        return data[6] == 0 ? ESP_OK : ESP_FAIL;
     }
 
-    data_pkt = (uint8_t *)malloc(sizeof(uint8_t) * len);
-    if (data_pkt == NULL) {
-        ESP_LOGE(__FILE__, "Malloc data_pkt failed!");
+    pkt_stats.received++;
+    if (!capture_fp && !bt_adv_event_wanted(data, len)) {
+        /* Not from a badge, don't spend a slot and a bt_task wake up on it. */
+        pkt_stats.rejected++;
+        return ESP_OK;
+    }
+    if (len > BT_PKT_SLOT_SIZE) {
+        pkt_stats.oversized++;
         return ESP_FAIL;
     }
-    memcpy(data_pkt, data, len);
-    send_data.q_data = data_pkt;
-    send_data.q_data_len = len;
-    if (xQueueSend(adv_queue, (void *)&send_data, ( TickType_t ) 0) != pdTRUE) {
-        ESP_LOGD(__FILE__, "Failed to enqueue advertising report. Queue full.");
-        /* If data sent successfully, then free the pointer in `xQueueReceive'
-         * after processing it. Or else if enqueue in not successful, free it
-         * here. */
-        free(data_pkt);
+    if (xQueueReceive(pkt_free_queue, &send_data.slot, 0) != pdTRUE) {
+        /* Every slot is waiting for bt_task, drop the packet. */
+        pkt_stats.dropped++;
+        return ESP_OK;
+    }
+    uint32_t in_use = BT_PKT_POOL_SLOTS - uxQueueMessagesWaiting(pkt_free_queue);
+    if (in_use > pkt_stats.high_water) {
+        pkt_stats.high_water = in_use;
     }
+
+    memcpy(pkt_pool[send_data.slot], data, len);
+    send_data.q_data_len = len;
+    /* adv_queue has room for every slot plus Command Completes, so it can't be full. */
+    xQueueSend(adv_queue, (void *)&send_data, ( TickType_t ) 0);
     return ESP_OK;
 }
 
+void bt_get_pkt_pool_stats(bt_pkt_pool_stats_t *stats)
+{
+    *stats = pkt_stats;
+}
+
+static void capture_close()
+{
+    ESP_LOGI(__FILE__, "HCI capture stopped, %lu bytes", (unsigned long)capture_bytes);
+    fclose(capture_fp);
+    capture_fp = NULL;
+}
+
+esp_err_t bt_capture_start(const char *path, uint32_t max_bytes)
+{
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(capture_lock, portMAX_DELAY);
+    if (capture_fp) {
+        capture_close();
+    }
+    FILE *fp = fopen(path, "wb");
+    if (fp) {
+        capture_bytes = 0;
+        capture_max = max_bytes;
+        capture_fp = fp;
+        ESP_LOGI(__FILE__, "HCI capture to %s (max %lu bytes)", path, (unsigned long)max_bytes);
+    } else {
+        ESP_LOGE(__FILE__, "Failed to open %s for HCI capture", path);
+        err = ESP_FAIL;
+    }
+    xSemaphoreGive(capture_lock);
+    return err;
+}
+
+void bt_capture_stop()
+{
+    xSemaphoreTake(capture_lock, portMAX_DELAY);
+    if (capture_fp) {
+        capture_close();
+    }
+    xSemaphoreGive(capture_lock);
+}
+
+bool bt_capture_active(uint32_t *bytes)
+{
+    if (bytes) *bytes = capture_bytes;
+    return capture_fp != NULL;
+}
+
+static void capture_write(const uint8_t *data, uint16_t len)
+{
+    xSemaphoreTake(capture_lock, portMAX_DELAY);
+    if (capture_fp) {
+        uint8_t hdr[2] = { len & 0xFF, len >> 8 };
+        if (capture_bytes + sizeof(hdr) + len > capture_max ||
+            fwrite(hdr, 1, sizeof(hdr), capture_fp) != sizeof(hdr) ||
+            fwrite(data, 1, len, capture_fp) != len) {
+            capture_close();
+        } else {
+            capture_bytes += sizeof(hdr) + len;
+        }
+    }
+    xSemaphoreGive(capture_lock);
+}
+
 static esp_vhci_host_callback_t vhci_host_cb = {
     controller_rcv_pkt_ready,
     host_rcv_pkt
@@ -157,14 +697,52 @@ static void hci_cmd_send_set_evt_mask(void)
     esp_vhci_host_send_packet(hci_cmd_buf, sz);
 }
 
+/*
+ * Scan profiles, from eager to lazy. Active scanning is only needed to get
+ * the names of badges we haven't heard a scan response from yet.
+ */
+enum {
+    BLE_SCAN_FAST,
+    BLE_SCAN_NORMAL,
+    BLE_SCAN_SLOW,
+};
+
+typedef struct {
+    const char *name;
+    uint16_t interval;
+    uint16_t window;
+    bool active;
+} ble_scan_profile_t;
+
+static const ble_scan_profile_t scan_profiles[] = {
+    [BLE_SCAN_FAST] = { "fast", BLE_SCAN_INTERVAL, BLE_SCAN_WINDOW, true },
+    [BLE_SCAN_NORMAL] = { "normal", BLE_SCAN_INTERVAL_NORMAL, BLE_SCAN_WINDOW, true },
+    [BLE_SCAN_SLOW] = { "slow", BLE_SCAN_INTERVAL_SLOW, BLE_SCAN_WINDOW, false },
+};
+
+static uint8_t scan_profile = BLE_SCAN_FAST;
+
+void bt_get_scan_state(bt_scan_state_t *state)
+{
+    const ble_scan_profile_t *profile = &scan_profiles[scan_profile];
+    state->profile = profile->name;
+    state->active = profile->active;
+    state->interval = profile->interval;
+    state->window = profile->window;
+    state->duty_permille = profile->window * 1000 / profile->interval;
+    state->est_current_ua = BLE_RX_CURRENT_MA * state->duty_permille;
+}
+
 static void hci_cmd_send_ble_scan_params(void)
 {
+    const ble_scan_profile_t *profile = &scan_profiles[scan_profile];
+
     /* Set scan type to 0x01 for active scanning and 0x00 for passive scanning. */
-    uint8_t scan_type = 0x01;
+    uint8_t scan_type = profile->active ? 0x01 : 0x00;
 
     /* Scan window and Scan interval are set in terms of number of slots. Each slot is of 625 microseconds. */
-    uint16_t scan_interval = BLE_SCAN_INTERVAL;//0x50; /* 50 ms */
-    uint16_t scan_window = BLE_SCAN_WINDOW;//0x30; /* 30 ms */
+    uint16_t scan_interval = profile->interval;
+    uint16_t scan_window = profile->window;
 
     uint8_t own_addr_type = 0x00; /* Public Device Address (default). */
     uint8_t filter_policy = 0x00; /* Accept all packets excpet directed advertising packets (default). */
@@ -175,12 +753,20 @@ static void hci_cmd_send_ble_scan_params(void)
 static void hci_cmd_send_ble_scan_start(void)
 {
     uint8_t scan_enable = 0x01; /* Scanning enabled. */
-    uint8_t filter_duplicates = 0x00; /* Duplicate filtering disabled. */
+    /* With duplicate filtering the controller reports each address once
+     * per scan, bt_task restarts the scan every BLE_DUP_REFRESH_MS. */
+    uint8_t filter_duplicates = BLE_SCAN_FILTER_DUPLICATES;
     uint16_t sz = make_cmd_ble_set_scan_enable(hci_cmd_buf, scan_enable, filter_duplicates);
     esp_vhci_host_send_packet(hci_cmd_buf, sz);
     ESP_LOGI(__FILE__, "BLE Scanning started..");
 }
 
+static void hci_cmd_send_ble_scan_stop(void)
+{
+    uint16_t sz = make_cmd_ble_set_scan_enable(hci_cmd_buf, 0x00, 0x00);
+    esp_vhci_host_send_packet(hci_cmd_buf, sz);
+}
+
 static void hci_cmd_send_ble_adv_start(void)
 {
     uint16_t sz = make_cmd_ble_set_adv_enable (hci_cmd_buf, 1);
@@ -222,46 +808,87 @@ static void hci_cmd_send_ble_set_adv_param(void)
     esp_vhci_host_send_packet(hci_cmd_buf, sz);
 }
 
+uint16_t badge_name_hash(const char *name)
+{
+    /* FNV-1a folded to 16 bits */
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < BADGE_NAME_MAX_SIZE - 1 && name[i]; i++) {
+        h ^= (uint8_t)name[i];
+        h *= 16777619u;
+    }
+    return (h >> 16) ^ (h & 0xFFFF);
+}
+
 static void hci_cmd_send_ble_set_adv_data(void)
 {
-    
+    ESP_LOGI(__FILE__, "DEVICE ID = %d", badge_obj.device_id);
+
+    uint8_t adv_data[31] = {0x02, 0x01, 0x06};
+    badge_adv_t adv = {
+        .len = sizeof(badge_adv_t) - 1,
+        .type = 0xFF,
+        .company = BADGE_ADV_COMPANY_ID,
+        .magic = BADGE_ADV_MAGIC,
+        .version = BADGE_ADV_VERSION,
+        .id = badge_obj.device_id,
+        .flags = 0,
+        .name_hash = badge_name_hash(badge_obj.device_name),
+    };
+    memcpy(&adv_data[BADGE_ADV_OFFSET], &adv, sizeof(adv));
+    uint8_t adv_data_len = BADGE_ADV_OFFSET + sizeof(adv);
+
+    uint16_t sz = make_cmd_ble_set_adv_data(hci_cmd_buf, adv_data_len, (uint8_t *)adv_data);
+    esp_vhci_host_send_packet(hci_cmd_buf, sz);
+}
+
+static void hci_cmd_send_ble_set_scan_rsp_data(void)
+{
+    /* Older badges only know the "[id] name" local name. */
     char adv_name[32];
     snprintf(adv_name, 32, "[%u] %s", badge_obj.device_id, badge_obj.device_name);
 
-    ESP_LOGI(__FILE__, "DEVICE ID = %d", badge_obj.device_id);
     ESP_LOGI(__FILE__, "ADV NAME = %s", adv_name);
     
     uint8_t name_len = (uint8_t)strlen(adv_name);
-    uint8_t adv_data[31] = {0x02, 0x01, 0x06, 0x0, 0x09};
-    uint8_t adv_data_len;
+    uint8_t rsp_data[31] = {0x0, 0x09};
 
-    adv_data[3] = name_len + 1;
-    for (int i = 0; i < name_len; i++) {
-        adv_data[5 + i] = (uint8_t)adv_name[i];
-    }
-    adv_data_len = 5 + adv_data[3];
+    rsp_data[0] = name_len + 1;
+    memcpy(&rsp_data[2], adv_name, name_len);
 
-    uint16_t sz = make_cmd_ble_set_adv_data(hci_cmd_buf, adv_data_len, (uint8_t *)adv_data);
+    uint16_t sz = make_cmd_ble_set_scan_rsp_data(hci_cmd_buf, 2 + name_len, (uint8_t *)rsp_data);
     esp_vhci_host_send_packet(hci_cmd_buf, sz);
     ESP_LOGI(__FILE__, "Starting BLE advertising with name \"%s\"", adv_name);
 }
 
-static esp_err_t get_local_name (uint8_t *data_msg, uint8_t data_len, ble_scan_local_name_t *scanned_packet)
+/* One LE Advertising Report, pointing into the received HCI event. */
+typedef struct {
+    uint8_t event_type;
+    uint8_t addr_type;
+    const uint8_t *addr;
+    const uint8_t *data;
+    uint8_t data_len;
+    short rssi;
+} ble_adv_report_t;
+
+static esp_err_t get_local_name (const uint8_t *data_msg, uint8_t data_len, ble_scan_local_name_t *scanned_packet)
 {
     uint8_t curr_ptr = 0, curr_len, curr_type;
-    while (curr_ptr < data_len) {
+    while (curr_ptr + 1 < data_len) {
         curr_len = data_msg[curr_ptr++];
         curr_type = data_msg[curr_ptr++];
-        if (curr_len == 0) {
+        if (curr_len == 0 || curr_ptr + curr_len - 1 > data_len) {
             return ESP_FAIL;
         }
 
         /* Search for current data type and see if it contains name as data (0x08 or 0x09). */
         if (curr_type == 0x08 || curr_type == 0x09) {
-            for (uint8_t i = 0; i < curr_len - 1; i += 1) {
-                scanned_packet->scan_local_name[i] = data_msg[curr_ptr + i];
+            uint8_t name_len = curr_len - 1;
+            if (name_len >= sizeof(scanned_packet->scan_local_name)) {
+                name_len = sizeof(scanned_packet->scan_local_name) - 1;
             }
-            scanned_packet->name_len = curr_len - 1;
+            memcpy(scanned_packet->scan_local_name, &data_msg[curr_ptr], name_len);
+            scanned_packet->scan_local_name[name_len] = '\0';
+            scanned_packet->name_len = name_len;
             return ESP_OK;
         } else {
             /* Search for next data. Current length includes 1 octate for AD Type (2nd octate). */
@@ -271,10 +898,315 @@ static esp_err_t get_local_name (uint8_t *data_msg, uint8_t data_len, ble_scan_l
     return ESP_FAIL;
 }
 
+/*
+ * Walks an HCI LE Advertising Report event in place. The controller packs
+ * the fields of all reports as consecutive arrays (event types, address
+ * types, addresses, data lengths, data, RSSIs), so each report is a set of
+ * offsets into `pkt` and nothing is copied.
+ * Returns the number of reports stored in `reports` or -1 if malformed.
+ */
+static int parse_adv_reports(const uint8_t *pkt, uint16_t len, ble_adv_report_t *reports, uint8_t max_reports)
+{
+    /* H4 type, event code, parameter length, sub event, number of reports. */
+    uint16_t data_ptr = 4;
+    if (len <= data_ptr) {
+        return -1;
+    }
+    uint8_t num_responses = pkt[data_ptr++];
+
+    /* Event type, address type, address, data length and RSSI per report. */
+    if (data_ptr + num_responses * (1 + 1 + BD_ADDR_LEN + 1 + 1) > len) {
+        return -1;
+    }
+    const uint8_t *event_type = &pkt[data_ptr];
+    const uint8_t *addr_type = event_type + num_responses;
+    const uint8_t *addr = addr_type + num_responses;
+    const uint8_t *data_len = addr + BD_ADDR_LEN * num_responses;
+    const uint8_t *data_msg = data_len + num_responses;
+
+    uint16_t total_data_len = 0;
+    for (uint8_t i = 0; i < num_responses; i++) {
+        total_data_len += data_len[i];
+    }
+    const uint8_t *rssi = data_msg + total_data_len;
+    if (rssi + num_responses > pkt + len) {
+        return -1;
+    }
+
+    uint8_t num = num_responses < max_reports ? num_responses : max_reports;
+    uint16_t data_msg_ptr = 0;
+    for (uint8_t i = 0; i < num; i++) {
+        reports[i].event_type = event_type[i];
+        reports[i].addr_type = addr_type[i];
+        reports[i].addr = &addr[BD_ADDR_LEN * i];
+        reports[i].data = &data_msg[data_msg_ptr];
+        reports[i].data_len = data_len[i];
+        reports[i].rssi = -(0xFF - rssi[i]);
+        data_msg_ptr += data_len[i];
+    }
+    return num;
+}
+
+/* Returns the badge advertisement in an AD payload, NULL if there is none. */
+static const badge_adv_t *badge_adv_decode(const uint8_t *data, uint8_t len)
+{
+    if (len < BADGE_ADV_OFFSET + sizeof(badge_adv_t)) {
+        return NULL;
+    }
+    const badge_adv_t *adv = (const badge_adv_t *)&data[BADGE_ADV_OFFSET];
+    if (adv->magic != BADGE_ADV_MAGIC || adv->len < sizeof(badge_adv_t) - 1 ||
+        adv->type != 0xFF || adv->company != BADGE_ADV_COMPANY_ID || adv->version != BADGE_ADV_VERSION) {
+        return NULL;
+    }
+    return adv;
+}
+
+/* Cheap check for a "[id] name" local name, without copying it. */
+static bool has_badge_name(const uint8_t *data, uint8_t len)
+{
+    size_t ptr = 0;
+    while (ptr + 2 < len) {
+        uint8_t ad_len = data[ptr];
+        uint8_t ad_type = data[ptr + 1];
+        if (ad_len == 0 || ptr + 1 + ad_len > len) {
+            return false;
+        }
+        if (ad_type == 0x08 || ad_type == 0x09) {
+            return ad_len > 1 && data[ptr + 2] == '[';
+        }
+        ptr += ad_len + 1;
+    }
+    return false;
+}
+
+/*
+ * Early reject run in the controller callback: keep Advertising Report
+ * events with at least one report that looks like a badge.
+ */
+bool bt_adv_event_wanted(const uint8_t *data, uint16_t len)
+{
+    if (len < 5 || data[1] != LE_META_EVENTS || data[3] != HCI_LE_ADV_REPORT) {
+        return false;
+    }
+    uint8_t num = data[4];
+    uint16_t data_len_ptr = 5 + num * (1 + 1 + BD_ADDR_LEN);
+    uint16_t data_ptr = data_len_ptr + num;
+    for (uint8_t i = 0; i < num; i++) {
+        if (data_len_ptr + i >= len) {
+            return false;
+        }
+        uint8_t data_len = data[data_len_ptr + i];
+        if (data_ptr + data_len > len) {
+            return false;
+        }
+        if (badge_adv_decode(&data[data_ptr], data_len) || has_badge_name(&data[data_ptr], data_len)) {
+            return true;
+        }
+        data_ptr += data_len;
+    }
+    return false;
+}
+
+int bt_process_packet(const uint8_t *data, uint16_t len)
+{
+    ble_adv_report_t reports[BLE_MAX_REPORTS];
+    ble_scan_local_name_t scanned_name;
+
+    if (len < 4 || data[1] != LE_META_EVENTS || data[3] != HCI_LE_ADV_REPORT) {
+        return 0;
+    }
+    scanned_count += 1;
+
+    int num = parse_adv_reports(data, len, reports, BLE_MAX_REPORTS);
+    if (num < 0) {
+        ESP_LOGD(__FILE__, "Malformed advertising report (%d bytes)", len);
+        return 0;
+    }
+
+    for (int i = 0; i < num; i++) {
+        const badge_adv_t *adv = badge_adv_decode(reports[i].data, reports[i].data_len);
+        if (adv) {
+            insert_badge_adv(reports[i].addr, adv, reports[i].rssi);
+        } else if (get_local_name(reports[i].data, reports[i].data_len, &scanned_name) == ESP_OK) {
+            insert(reports[i].addr, scanned_name.scan_local_name, scanned_name.name_len, reports[i].rssi);
+        }
+    }
+    if (nodes_dirty) {
+        publish_nodes();
+    }
+    return num;
+}
+
+static const hci_cmd_step_t boot_cmds[] = {
+    { "reset", HCI_RESET, hci_cmd_send_reset },
+    { "set event mask", HCI_SET_EVT_MASK, hci_cmd_send_set_evt_mask },
+
+    /* Advertising commands. */
+    { "adv params", HCI_BLE_WRITE_ADV_PARAMS, hci_cmd_send_ble_set_adv_param },
+    { "adv data", HCI_BLE_WRITE_ADV_DATA, hci_cmd_send_ble_set_adv_data },
+    { "scan rsp data", HCI_BLE_WRITE_SCAN_RSP_DATA, hci_cmd_send_ble_set_scan_rsp_data },
+    { "adv enable", HCI_BLE_WRITE_ADV_ENABLE, hci_cmd_send_ble_adv_start },
+
+    /* Scan commands. */
+    { "scan params", HCI_BLE_WRITE_SCAN_PARAM, hci_cmd_send_ble_scan_params },
+    { "scan enable", HCI_BLE_WRITE_SCAN_ENABLE, hci_cmd_send_ble_scan_start },
+};
+
+static const hci_cmd_step_t scan_refresh_cmds[] = {
+    { "scan disable", HCI_BLE_WRITE_SCAN_ENABLE, hci_cmd_send_ble_scan_stop },
+    { "scan enable", HCI_BLE_WRITE_SCAN_ENABLE, hci_cmd_send_ble_scan_start },
+};
+
+static const hci_cmd_step_t scan_profile_cmds[] = {
+    { "scan disable", HCI_BLE_WRITE_SCAN_ENABLE, hci_cmd_send_ble_scan_stop },
+    { "scan params", HCI_BLE_WRITE_SCAN_PARAM, hci_cmd_send_ble_scan_params },
+    { "scan enable", HCI_BLE_WRITE_SCAN_ENABLE, hci_cmd_send_ble_scan_start },
+};
+
+/*
+ * HCI command sequencer. Commands are sent one at a time from bt_task; the
+ * next one goes out as soon as the Command Complete of the previous one
+ * arrives, or after HCI_CMD_TIMEOUT_MS if it never does.
+ */
+static const hci_cmd_step_t *cmd_seq;
+static uint8_t cmd_seq_len;
+static uint8_t cmd_seq_pos;
+static bool cmd_pending = false;
+static int64_t cmd_sent_us;
+static int64_t cmd_seq_start_us;
+
+static void hci_seq_send()
+{
+    if (cmd_pending || cmd_seq_pos >= cmd_seq_len) return;
+    if (!esp_vhci_host_check_send_available()) return; // retried on the next bt_task wake up
+
+    cmd_sent_us = esp_timer_get_time();
+    cmd_pending = true;
+    cmd_seq[cmd_seq_pos].send();
+}
+
+static void hci_seq_start(const hci_cmd_step_t *steps, uint8_t len)
+{
+    cmd_seq = steps;
+    cmd_seq_len = len;
+    cmd_seq_pos = 0;
+    cmd_pending = false;
+    cmd_seq_start_us = esp_timer_get_time();
+    hci_seq_send();
+}
+
+static bool hci_seq_busy()
+{
+    return cmd_seq_pos < cmd_seq_len;
+}
+
+static void hci_seq_advance()
+{
+    cmd_pending = false;
+    if (++cmd_seq_pos == cmd_seq_len) {
+        ESP_LOGI(__FILE__, "HCI sequence done in %" PRId64 " ms", (esp_timer_get_time() - cmd_seq_start_us) / 1000);
+    }
+    hci_seq_send();
+}
+
+static void hci_cmd_complete(uint16_t opcode, uint8_t status)
+{
+    if (!cmd_pending || cmd_seq[cmd_seq_pos].opcode != opcode) {
+        ESP_LOGD(__FILE__, "Unexpected Command Complete for opcode 0x%04x", opcode);
+        return;
+    }
+    if (status == 0) {
+        ESP_LOGI(__FILE__, "HCI %s done in %" PRId64 " us", cmd_seq[cmd_seq_pos].name, esp_timer_get_time() - cmd_sent_us);
+    } else {
+        ESP_LOGE(__FILE__, "HCI %s failed with reason: 0x%02x", cmd_seq[cmd_seq_pos].name, status);
+    }
+    hci_seq_advance();
+}
+
+static void hci_seq_check_timeout()
+{
+    if (cmd_pending && esp_timer_get_time() - cmd_sent_us > HCI_CMD_TIMEOUT_MS * 1000) {
+        ESP_LOGW(__FILE__, "HCI %s timed out", cmd_seq[cmd_seq_pos].name);
+        hci_seq_advance();
+    } else {
+        hci_seq_send();
+    }
+}
+
+static uint32_t scan_joins_seen = 0;
+static uint32_t scan_stable_tick;
+static uint32_t scan_eval_tick;
+static uint32_t scan_refresh_tick;
+
+/*
+ * Scan fast while the neighbourhood changes: a badge joined, a badge
+ * still has no name (needs a scan response) or one hasn't been heard for
+ * half of NODE_QUEUE_TIMEOUT_MS and is about to expire. Back off once it
+ * has been stable for a while.
+ */
+static uint8_t scan_pick_profile(uint32_t now)
+{
+    bool churn = node_joins != scan_joins_seen;
+    scan_joins_seen = node_joins;
+
+    for (int i = 0; !churn && i < node_count; i++) {
+        const ble_node_t *node = &ble_nodes[node_order[i]];
+        churn = node->name[0] == '\0' ||
+                pdTICKS_TO_MS(now - node->last_found) > NODE_QUEUE_TIMEOUT_MS / 2;
+    }
+    if (churn) {
+        scan_stable_tick = now;
+    }
+
+    uint32_t stable_ms = pdTICKS_TO_MS(now - scan_stable_tick);
+    if (stable_ms >= BLE_SCAN_SLOW_AFTER_MS) return BLE_SCAN_SLOW;
+    if (stable_ms >= BLE_SCAN_NORMAL_AFTER_MS) return BLE_SCAN_NORMAL;
+    return BLE_SCAN_FAST;
+}
+
+/* Scan profile changes and duplicate filter refreshes. Returns how long
+ * bt_task may sleep before it has to call again. */
+static uint32_t scan_service(uint32_t now)
+{
+    if (hci_seq_busy()) {
+        return HCI_CMD_TIMEOUT_MS;
+    }
+
+    uint32_t since_eval = pdTICKS_TO_MS(now - scan_eval_tick);
+    if (since_eval >= BLE_SCAN_EVAL_MS) {
+        scan_eval_tick = now;
+        since_eval = 0;
+        uint8_t profile = scan_pick_profile(now);
+        if (profile != scan_profile) {
+            ESP_LOGI(__FILE__, "Scan profile %s -> %s", scan_profiles[scan_profile].name, scan_profiles[profile].name);
+            scan_profile = profile;
+            /* Restarting the scan clears the duplicate filter too. */
+            hci_seq_start(scan_profile_cmds, SIZEOF(scan_profile_cmds));
+            scan_refresh_tick = now;
+            return HCI_CMD_TIMEOUT_MS;
+        }
+    }
+    uint32_t wait = BLE_SCAN_EVAL_MS - since_eval;
+
+    if (BLE_SCAN_FILTER_DUPLICATES) {
+        /* Restart the scan to clear the controller's duplicate filter,
+         * otherwise nodes stop getting RSSI updates and time out. */
+        uint32_t since_refresh = pdTICKS_TO_MS(now - scan_refresh_tick);
+        if (since_refresh >= BLE_DUP_REFRESH_MS) {
+            hci_seq_start(scan_refresh_cmds, SIZEOF(scan_refresh_cmds));
+            scan_refresh_tick = now;
+            pkt_stats.scan_refreshes++;
+            return HCI_CMD_TIMEOUT_MS;
+        }
+        if (BLE_DUP_REFRESH_MS - since_refresh < wait) {
+            wait = BLE_DUP_REFRESH_MS - since_refresh;
+        }
+    }
+    return wait;
+}
+
 void bt_init()
 {
-    bool continue_commands = 1;
-    int cmd_cnt = 0;
     esp_err_t ret;
     
     esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
@@ -295,180 +1227,53 @@ void bt_init()
         return;
     }
 
-    /* A queue for storing received HCI packets. */
-    adv_queue = xQueueCreate(15, sizeof(host_rcv_data_t));
-    if (adv_queue == NULL) {
+    /* A queue for storing received HCI packets and Command Completes. */
+    adv_queue = xQueueCreate(BT_PKT_POOL_SLOTS + 4, sizeof(host_rcv_data_t));
+    pkt_free_queue = xQueueCreate(BT_PKT_POOL_SLOTS, sizeof(uint8_t));
+    capture_lock = xSemaphoreCreateMutex();
+    if (adv_queue == NULL || pkt_free_queue == NULL || capture_lock == NULL) {
         ESP_LOGE(__FILE__, "Queue creation failed\n");
         return;
     }
-
-    esp_vhci_host_register_callback(&vhci_host_cb);
-    while (continue_commands) {
-        if (continue_commands && esp_vhci_host_check_send_available()) {
-            switch (cmd_cnt) {
-                case 0: hci_cmd_send_reset(); ++cmd_cnt; break;
-                case 1: hci_cmd_send_set_evt_mask(); ++cmd_cnt; break;
-
-                /* Send advertising commands. */
-                case 2: hci_cmd_send_ble_set_adv_param(); ++cmd_cnt; break;
-                case 3: hci_cmd_send_ble_set_adv_data(); ++cmd_cnt; break;
-                case 4: hci_cmd_send_ble_adv_start(); ++cmd_cnt; break;
-
-                /* Send scan commands. */
-                case 5: hci_cmd_send_ble_scan_params(); ++cmd_cnt; break;
-                case 6: hci_cmd_send_ble_scan_start(); ++cmd_cnt; break;
-                default: continue_commands = 0; break;
-            }
-            ESP_LOGI(__FILE__, "BLE Advertise, cmd_sent: %d", cmd_cnt);
-        }
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
+    for (uint8_t i = 0; i < BT_PKT_POOL_SLOTS; i++) {
+        xQueueSend(pkt_free_queue, &i, 0);
     }
 
     init_ble_nodes();
+    esp_vhci_host_register_callback(&vhci_host_cb);
 }
 
 void bt_task(void *unused)
 {    
-    host_rcv_data_t *rcv_data = (host_rcv_data_t *)malloc(sizeof(host_rcv_data_t));
-    if (rcv_data == NULL) {
-        ESP_LOGE(__FILE__, "Malloc rcv_data failed!");
-        return;
-    }
-    esp_err_t ret;
+    host_rcv_data_t rcv_data;
+
+    /* Controller setup runs here so app_main doesn't wait for it. */
+    hci_seq_start(boot_cmds, SIZEOF(boot_cmds));
+    scan_refresh_tick = scan_eval_tick = scan_stable_tick = xTaskGetTickCount();
 
     while (1) {
-        uint8_t sub_event, num_responses, total_data_len, data_msg_ptr, hci_event_opcode;
-        uint8_t *queue_data = NULL, *event_type = NULL, *addr_type = NULL, *addr = NULL, *data_len = NULL, *data_msg = NULL;
-        short int *rssi = NULL;
-        uint16_t data_ptr;
-        ble_scan_local_name_t *scanned_name = NULL;
-        total_data_len = 0;
-        data_msg_ptr = 0;
-
-        disable_nodes(xTaskGetTickCount());
-
-        if (xQueueReceive(adv_queue, rcv_data, pdMS_TO_TICKS(NODE_QUEUE_TIMEOUT_MS)) == pdPASS) {
-            /* `data_ptr' keeps track of current position in the received data. */
-            data_ptr = 0;
-            queue_data = rcv_data->q_data;
-
-            /* Parsing `data' and copying in various fields. */
-            hci_event_opcode = queue_data[++data_ptr];
-            if (hci_event_opcode == LE_META_EVENTS) {
-                /* Set `data_ptr' to 4th entry, which will point to sub event. */
-                data_ptr += 2;
-                sub_event = queue_data[data_ptr++];
-                /* Check if sub event is LE advertising report event. */
-                if (sub_event == HCI_LE_ADV_REPORT) {
-
-                    scanned_count += 1;
-
-                    /* Get number of advertising reports. */
-                    num_responses = queue_data[data_ptr++];
-                
-                    if(num_responses > MAX_NEARBY_NODE)
-                        num_responses = MAX_NEARBY_NODE;
-
-                    event_type = (uint8_t *)malloc(sizeof(uint8_t) * num_responses);
-                    if (event_type == NULL) {
-                        ESP_LOGE(__FILE__, "Malloc event_type failed!");
-                        goto reset;
-                    }
-                    for (uint8_t i = 0; i < num_responses; i += 1) {
-                        event_type[i] = queue_data[data_ptr++];
-                    }
-
-                    /* Get advertising type for every report. */
-                    addr_type = (uint8_t *)malloc(sizeof(uint8_t) * num_responses);
-                    if (addr_type == NULL) {
-                        ESP_LOGE(__FILE__, "Malloc addr_type failed!");
-                        goto reset;
-                    }
-                    for (uint8_t i = 0; i < num_responses; i += 1) {
-                        addr_type[i] = queue_data[data_ptr++];
-                    }
-
-                    /* Get BD address in every advetising report and store in
-                     * single array of length `6 * num_responses' as each address
-                     * will take 6 spaces. */
-                    addr = (uint8_t *)malloc(sizeof(uint8_t) * 6 * num_responses);
-                    if (addr == NULL) {
-                        ESP_LOGE(__FILE__, "Malloc addr failed!");
-                        goto reset;
-                    }
-                    for (int i = 0; i < num_responses; i += 1) {
-                        for (int j = 0; j < 6; j += 1) {
-                            addr[(6 * i) + j] = queue_data[data_ptr++];
-                        }
-                    }
-
-                    /* Get length of data for each advertising report. */
-                    data_len = (uint8_t *)malloc(sizeof(uint8_t) * num_responses);
-                    if (data_len == NULL) {
-                        ESP_LOGE(__FILE__, "Malloc data_len failed!");
-                        goto reset;
-                    }
-                    for (uint8_t i = 0; i < num_responses; i += 1) {
-                        data_len[i] = queue_data[data_ptr];
-                        total_data_len += queue_data[data_ptr++];
-                    }
-
-                    if (total_data_len != 0) {
-                        /* Get all data packets. */
-                        data_msg = (uint8_t *)malloc(sizeof(uint8_t) * total_data_len);
-                        if (data_msg == NULL) {
-                            ESP_LOGE(__FILE__, "Malloc data_msg failed!");
-                            goto reset;
-                        }
-                        for (uint8_t i = 0; i < num_responses; i += 1) {
-                            for (uint8_t j = 0; j < data_len[i]; j += 1) {
-                                data_msg[data_msg_ptr++] = queue_data[data_ptr++];
-                            }
-                        }
-                    }
-
-                    /* Counts of advertisements done. This count is set in advertising data every time before advertising. */
-                    rssi = (short int *)malloc(sizeof(short int) * num_responses);
-                    if (data_len == NULL) {
-                        ESP_LOGE(__FILE__, "Malloc rssi failed!");
-                        goto reset;
-                    }
-                    for (uint8_t i = 0; i < num_responses; i += 1) {
-                        rssi[i] = -(0xFF - queue_data[data_ptr++]);
-                    }
-
-                    /* Extracting advertiser's name. */
-                    data_msg_ptr = 0;
-                    scanned_name = (ble_scan_local_name_t *)malloc(num_responses * sizeof(ble_scan_local_name_t));
-                    if (data_len == NULL) {
-                        ESP_LOGE(__FILE__, "Malloc scanned_name failed!");
-                        goto reset;
-                    }
-                    for (uint8_t i = 0; i < num_responses; i += 1) {
-                        ret = get_local_name(&data_msg[data_msg_ptr], data_len[i], scanned_name);
-
-                        /* Print the data if adv report has a valid name. */
-                        if (ret == ESP_OK) {
-                            scanned_name->scan_local_name[scanned_name->name_len] = '\0';
-                            //add_ble_node(scanned_name->scan_local_name, scanned_name->name_len, rssi[i]);
-                            insert(scanned_name->scan_local_name, scanned_name->name_len, rssi[i]);
-                        }
-                    }
-
-                    /* Freeing all spaces allocated. */
-reset:
-                    //ESP_LOGI(__FILE__, "BT ADV freeing memory");
-                    free(scanned_name);
-                    free(rssi);
-                    free(data_msg);
-                    free(data_len);
-                    free(addr);
-                    free(addr_type);
-                    free(event_type);
+        uint32_t now = xTaskGetTickCount();
+        expire_nodes(now);
+
+        uint32_t timeout = pdMS_TO_TICKS(scan_service(now));
+        uint32_t expiry = next_expiry(now);
+        if (expiry < timeout) {
+            timeout = expiry;
+        }
+        if (xQueueReceive(adv_queue, &rcv_data, timeout) == pdPASS) {
+            if (rcv_data.q_data_len == 0) {
+                hci_cmd_complete(rcv_data.opcode, rcv_data.status);
+            } else {
+                if (capture_fp) {
+                    capture_write(pkt_pool[rcv_data.slot], rcv_data.q_data_len);
                 }
+                bt_process_packet(pkt_pool[rcv_data.slot], rcv_data.q_data_len);
+                xQueueSend(pkt_free_queue, &rcv_data.slot, 0);
+                pkt_stats.processed++;
             }
-            free(queue_data);
         }
-        memset(rcv_data, 0, sizeof(host_rcv_data_t));
+        if (hci_seq_busy()) {
+            hci_seq_check_timeout();
+        }
     }
 }
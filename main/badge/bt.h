@@ -7,6 +7,8 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
 
 #include "common/bt_hci_common.h"
 
@@ -15,13 +17,132 @@
 
 #define BLE_SCAN_INTERVAL 0x50 // it will scan every X * 0,625ms
 #define BLE_SCAN_WINDOW 0x30 // it will scan for X * 0,625ms
+#define BLE_SCAN_INTERVAL_NORMAL 0x80 // scan interval once the neighbourhood is stable
+#define BLE_SCAN_INTERVAL_SLOW 0x100 // and once it has been stable for long, passive
+#define BLE_SCAN_EVAL_MS 1000 // how often the scan profile is reconsidered
+#define BLE_SCAN_NORMAL_AFTER_MS 15000
+#define BLE_SCAN_SLOW_AFTER_MS 60000
+#define BLE_RX_CURRENT_MA 84 // ESP32-C3 radio receiving, from the datasheet
+#define BLE_SCAN_FILTER_DUPLICATES 1 // let the controller drop repeated adverts
+#define BLE_DUP_REFRESH_MS 5000 // restart the scan to clear the duplicate filter
 
 #define BLE_ADV_MIN 5 * 0x640 // X seconds * 0x640
 #define BLE_ADV_MAX 5 * 0x640 // X seconds * 0x640
 
 #define NODE_QUEUE_TIMEOUT_MS 20000
 
+/* Distance buckets, the same ranges as the radar on the web page. A node's
+ * RSSI is smoothed (new sample weight BLE_RSSI_EWMA_ALPHA/256) and it only
+ * changes bucket once it is BLE_RSSI_HYSTERESIS dB past the boundary. */
+#define BLE_BUCKET_NEAR 0
+#define BLE_BUCKET_MID 1
+#define BLE_BUCKET_FAR 2
+#define BLE_RSSI_NEAR -30
+#define BLE_RSSI_MID -50
+#define BLE_RSSI_HYSTERESIS 3
+#define BLE_RSSI_EWMA_ALPHA 64
+#define HCI_CMD_TIMEOUT_MS 1000 // give up waiting for a Command Complete
+#define BLE_MAX_REPORTS 25 // most advertising reports one HCI event can hold
+
+/* Received HCI packets waiting for bt_task. A slot fits the largest HCI
+ * event: H4 type, event code, parameter length and 255 parameter bytes. */
+#define BT_PKT_POOL_SLOTS 24
+#define BT_PKT_SLOT_SIZE (3 + 255)
+
+/*
+ * Badge advertisement: a manufacturer specific AD structure right after the
+ * flags, so receivers check it at a fixed offset. The "[id] name" string
+ * moved to the scan response, where older badges still find it.
+ */
+#define BADGE_ADV_OFFSET 3          // after the 3 byte flags AD structure
+#define BADGE_ADV_COMPANY_ID 0xFFFF // no assigned company identifier
+#define BADGE_ADV_MAGIC 0x3557      // "W5", little endian on air
+#define BADGE_ADV_VERSION 1
+
+typedef struct __attribute__((packed)) {
+    uint8_t len;        // AD length, counts type to the end
+    uint8_t type;       // 0xFF, manufacturer specific data
+    uint16_t company;
+    uint16_t magic;
+    uint8_t version;
+    uint8_t id;         // badge id 1..7
+    uint8_t flags;      // none defined yet, sent as 0
+    uint16_t name_hash; // badge_name_hash() of the device name
+} badge_adv_t;
+
+typedef struct {
+    uint32_t received;   // packets handed over by the controller
+    uint32_t processed;  // parsed by bt_task
+    uint32_t rejected;   // not from a badge, dropped before adv_queue
+    uint32_t dropped;    // no free slot, bt_task is behind
+    uint32_t oversized;  // longer than BT_PKT_SLOT_SIZE
+    uint32_t high_water; // most slots in use at once
+    uint32_t scan_refreshes; // scan restarts to clear the duplicate filter
+} bt_pkt_pool_stats_t;
+
 void bt_init();
 void bt_task(void *);
 
+/*
+ * Parse one HCI event as received from the controller and update the
+ * nearby node table. Returns the number of advertising reports handled.
+ */
+int bt_process_packet(const uint8_t *data, uint16_t len);
+
+/*
+ * Early reject run in the controller callback, before bt_process_packet():
+ * true if an Advertising Report event has a report that looks like a badge.
+ */
+bool bt_adv_event_wanted(const uint8_t *data, uint16_t len);
+
+void bt_get_pkt_pool_stats(bt_pkt_pool_stats_t *stats);
+
+typedef struct {
+    uint32_t updates;          // advertising reports applied to a node
+    uint32_t bucket_changes;   // updates that moved a node to another bucket
+    uint32_t publishes;        // snapshots published to the other tasks
+    uint32_t expired;          // nodes dropped after NODE_QUEUE_TIMEOUT_MS
+    uint32_t jitter_max_ms;    // worst delay past a node's deadline
+    uint64_t jitter_total_ms;  // sum of the delays, for the average
+} bt_node_stats_t;
+
+void bt_get_node_stats(bt_node_stats_t *stats);
+
+typedef struct {
+    const char *profile;     // "fast", "normal" or "slow"
+    bool active;             // active scanning, sends scan requests
+    uint16_t interval;       // in 0.625 ms slots
+    uint16_t window;         // in 0.625 ms slots
+    uint16_t duty_permille;  // share of the time the radio listens
+    uint32_t est_current_ua; // average receive current this costs
+} bt_scan_state_t;
+
+void bt_get_scan_state(bt_scan_state_t *state);
+
+/* Changes of the nearby node table, set once the new table is published. */
+#define BLE_EVENT_NODE_JOINED  BIT0
+#define BLE_EVENT_NODE_LEFT    BIT1 // expired or pushed out by a closer node
+#define BLE_EVENT_SET_COMPLETE BIT2 // all 7 ids are around (counting ours)
+#define BLE_EVENT_SET_BROKEN   BIT3 // and no longer are
+#define BLE_EVENT_RSSI_BUCKET  BIT4 // a node moved between near/mid/far
+#define BLE_EVENTS_ALL (BLE_EVENT_NODE_JOINED | BLE_EVENT_NODE_LEFT | BLE_EVENT_SET_COMPLETE | \
+                        BLE_EVENT_SET_BROKEN | BLE_EVENT_RSSI_BUCKET)
+#define BLE_EVENT_SUBSCRIBERS_MAX 4
+
+/* An event group of its own for the calling consumer, which waits on it
+ * with xEventGroupWaitBits(..., pdTRUE, ...). Call once, at task start. */
+EventGroupHandle_t ble_events_subscribe();
+
+/* Record the HCI packets bt_task receives to `path`, see bt.c for the
+ * format. Capture stops by itself once the file would exceed max_bytes. */
+#define BT_CAPTURE_FILE "/data/hci.cap" // outside BASE_PATH, POST capture downloads it
+#define BT_CAPTURE_MAX_BYTES (256 * 1024)
+
+esp_err_t bt_capture_start(const char *path, uint32_t max_bytes);
+void bt_capture_stop();
+bool bt_capture_active(uint32_t *bytes);
+
+// FNV-1a of at most BADGE_NAME_MAX_SIZE - 1 bytes of the name, folded to 16 bits
+uint16_t badge_name_hash(const char *name);
+
 #endif
\ No newline at end of file
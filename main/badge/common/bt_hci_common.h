@@ -15,6 +15,7 @@ extern "C" {
 
 #include "stdio.h"
 #include "string.h"
+#include "stdint.h"
 
 #define HCI_H4_CMD_PREAMBLE_SIZE           (4)
 
@@ -29,6 +30,7 @@ extern "C" {
 #define HCI_BLE_WRITE_ADV_ENABLE        (0x000A | HCI_GRP_BLE_CMDS)
 #define HCI_BLE_WRITE_ADV_DATA          (0x0008 | HCI_GRP_BLE_CMDS)
 #define HCI_BLE_WRITE_ADV_PARAMS        (0x0006 | HCI_GRP_BLE_CMDS)
+#define HCI_BLE_WRITE_SCAN_RSP_DATA     (0x0009 | HCI_GRP_BLE_CMDS)
 /* Scan commands */
 #define HCI_BLE_WRITE_SCAN_PARAM        (0x000B | HCI_GRP_BLE_CMDS)
 #define HCI_BLE_WRITE_SCAN_ENABLE       (0x000C | HCI_GRP_BLE_CMDS)
@@ -37,6 +39,7 @@ extern "C" {
 #define HCIC_PARAM_SIZE_WRITE_ADV_ENABLE        1
 #define HCIC_PARAM_SIZE_BLE_WRITE_ADV_PARAMS    15
 #define HCIC_PARAM_SIZE_BLE_WRITE_ADV_DATA      31
+#define HCIC_PARAM_SIZE_BLE_WRITE_SCAN_RSP_DATA 31
 #define HCIC_PARAM_SIZE_SET_EVENT_MASK          (8)
 #define HCIC_PARAM_SIZE_BLE_WRITE_SCAN_PARAM    (7)
 #define HCIC_PARAM_SIZE_BLE_WRITE_SCAN_ENABLE   (2)
@@ -111,6 +114,17 @@ uint16_t make_cmd_ble_set_adv_param (uint8_t *buf, uint16_t adv_int_min, uint16_
  */
 uint16_t make_cmd_ble_set_adv_data(uint8_t *buf, uint8_t data_len, uint8_t *p_data);
 
+/**
+ * @brief    This function is used to set the data sent in scan responses to active scanners.
+ *
+ * @param   buf       Input buffer to write which will be sent to controller.
+ * @param   data_len  Length of p_data.
+ * @param   p_data    Data to be set.
+ *
+ * @return  Size of buf after writing into it.
+ */
+uint16_t make_cmd_ble_set_scan_rsp_data(uint8_t *buf, uint8_t data_len, uint8_t *p_data);
+
 /**
  * @brief  This function is used to control which LE events are generated by the HCI for the Host.
  *         The event mask allows the Host to control which events will interrupt it.
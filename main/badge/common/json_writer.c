@@ -0,0 +1,175 @@
+#include "json_writer.h"
+
+static void write_out(json_writer_t *w)
+{
+    if (w->len && w->err == ESP_OK) {
+        w->err = w->flush(w->ctx, w->buf, w->len);
+        w->flushed += w->len;
+    }
+    w->len = 0;
+}
+
+static void put(json_writer_t *w, char c)
+{
+    if (w->len == w->size) {
+        write_out(w);
+    }
+    w->buf[w->len++] = c;
+}
+
+static void put_str(json_writer_t *w, const char *s)
+{
+    while (*s) {
+        put(w, *s++);
+    }
+}
+
+static void put_quoted(json_writer_t *w, const char *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    put(w, '"');
+    for (; *s; s++) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\') {
+            put(w, '\\');
+            put(w, c);
+        } else if (c == '\n') {
+            put_str(w, "\\n");
+        } else if (c < 0x20) {
+            put_str(w, "\\u00");
+            put(w, hex[c >> 4]);
+            put(w, hex[c & 0xF]);
+        } else {
+            put(w, c);
+        }
+    }
+    put(w, '"');
+}
+
+static void put_uint(json_writer_t *w, uint64_t v, int min_digits)
+{
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v || n < min_digits);
+    while (n) {
+        put(w, digits[--n]);
+    }
+}
+
+/* Separator and key of the next value in the current container. */
+static bool member(json_writer_t *w, const char *key)
+{
+    if (w->err != ESP_OK) {
+        return false;
+    }
+    if (w->depth) {
+        uint8_t bit = 1 << (w->depth - 1);
+        if (w->members & bit) {
+            put(w, ',');
+        }
+        w->members |= bit;
+    }
+    if (key) {
+        put_quoted(w, key);
+        put(w, ':');
+    }
+    return true;
+}
+
+static void container_open(json_writer_t *w, const char *key, char c)
+{
+    if (w->depth == JSON_DEPTH_MAX) {
+        w->err = ESP_ERR_INVALID_STATE;
+    }
+    if (member(w, key)) {
+        put(w, c);
+        w->depth++;
+        w->members &= ~(1 << (w->depth - 1));
+    }
+}
+
+static void container_close(json_writer_t *w, char c)
+{
+    if (w->err == ESP_OK && w->depth) {
+        put(w, c);
+        w->depth--;
+    }
+}
+
+void json_init(json_writer_t *w, char *buf, size_t size, json_flush_t flush, void *ctx)
+{
+    *w = (json_writer_t){ .buf = buf, .size = size, .flush = flush, .ctx = ctx, .err = ESP_OK };
+}
+
+void json_object_begin(json_writer_t *w, const char *key)
+{
+    container_open(w, key, '{');
+}
+
+void json_object_end(json_writer_t *w)
+{
+    container_close(w, '}');
+}
+
+void json_array_begin(json_writer_t *w, const char *key)
+{
+    container_open(w, key, '[');
+}
+
+void json_array_end(json_writer_t *w)
+{
+    container_close(w, ']');
+}
+
+void json_string(json_writer_t *w, const char *key, const char *value)
+{
+    if (member(w, key)) {
+        put_quoted(w, value);
+    }
+}
+
+void json_int(json_writer_t *w, const char *key, int64_t value)
+{
+    json_fixed(w, key, value, 0);
+}
+
+void json_fixed(json_writer_t *w, const char *key, int64_t value, uint8_t decimals)
+{
+    if (!member(w, key)) {
+        return;
+    }
+    uint64_t mag = value < 0 ? -(uint64_t)value : (uint64_t)value;
+    uint64_t scale = 1;
+    for (uint8_t i = 0; i < decimals; i++) {
+        scale *= 10;
+    }
+    uint64_t frac = mag % scale;
+    if (value < 0) {
+        put(w, '-');
+    }
+    put_uint(w, mag / scale, 1);
+    if (frac) {
+        while (frac % 10 == 0) {
+            frac /= 10;
+            decimals--;
+        }
+        put(w, '.');
+        put_uint(w, frac, decimals);
+    }
+}
+
+void json_bool(json_writer_t *w, const char *key, bool value)
+{
+    if (member(w, key)) {
+        put_str(w, value ? "true" : "false");
+    }
+}
+
+esp_err_t json_finish(json_writer_t *w)
+{
+    write_out(w);
+    return w->err;
+}
@@ -0,0 +1,45 @@
+#ifndef __JSON_WRITER_H__
+#define __JSON_WRITER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/*
+ * Writes JSON straight into a caller's buffer and hands it to `flush`
+ * whenever it fills up, without allocating. Members take their key,
+ * array elements and the top level value pass NULL. The first error
+ * `flush` returns is kept and everything after it is dropped.
+ */
+
+#define JSON_DEPTH_MAX 8
+
+typedef esp_err_t (*json_flush_t)(void *ctx, const void *data, size_t len);
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;      // waiting in buf
+    size_t flushed;  // handed to flush so far
+    json_flush_t flush;
+    void *ctx;
+    uint8_t depth;
+    uint8_t members; // bit n: the container at depth n has one already
+    esp_err_t err;
+} json_writer_t;
+
+void json_init(json_writer_t *w, char *buf, size_t size, json_flush_t flush, void *ctx);
+void json_object_begin(json_writer_t *w, const char *key);
+void json_object_end(json_writer_t *w);
+void json_array_begin(json_writer_t *w, const char *key);
+void json_array_end(json_writer_t *w);
+void json_string(json_writer_t *w, const char *key, const char *value);
+void json_int(json_writer_t *w, const char *key, int64_t value);
+// value / 10^decimals, as a number without trailing zeros
+void json_fixed(json_writer_t *w, const char *key, int64_t value, uint8_t decimals);
+void json_bool(json_writer_t *w, const char *key, bool value);
+// Flushes what is left, returns the first error
+esp_err_t json_finish(json_writer_t *w);
+
+#endif
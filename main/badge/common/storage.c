@@ -39,6 +39,6 @@ void spiffs_init()
     if (ret != ESP_OK) {
         ESP_LOGE(__FILE__, "Failed to get SPIFFS partition information (%s)", esp_err_to_name(ret));
     } else {
-        ESP_LOGI(__FILE__, "Partition size: total: %d, used: %d", total, used);
+        ESP_LOGI(__FILE__, "Partition size: total: %zu, used: %zu", total, used);
     }
 }
@@ -0,0 +1,235 @@
+#include <inttypes.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "esp_partition.h"
+#include "esp_timer.h"
+
+#include "badge.h"
+
+static const esp_partition_t *history_part = NULL;
+static uint32_t sector_total;
+
+/* bt_task is the only producer and history_task the only consumer, the
+ * indexes run freely and wrap with the ring length (a power of two). */
+static history_rec_t ring[HISTORY_RING_LEN];
+static atomic_uint ring_head;
+static atomic_uint ring_tail;
+
+static SemaphoreHandle_t flush_sem;
+static SemaphoreHandle_t flash_lock; // history_task writes vs. history_export reads
+
+/* Sector being filled. A full one makes the next flush erase the sector
+ * after it, which is how a boot starts a fresh sector. */
+static uint32_t cur_sector;
+static uint32_t cur_count = HISTORY_RECS_PER_SECTOR;
+static uint32_t next_seq;
+static uint32_t boot_seq;
+
+static history_stats_t stats;
+
+void history_init()
+{
+    flush_sem = xSemaphoreCreateBinary();
+    flash_lock = xSemaphoreCreateMutex();
+
+    history_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, HISTORY_PARTITION_SUBTYPE,
+                                            HISTORY_PARTITION_LABEL);
+    if (!history_part) {
+        ESP_LOGW(__FILE__, "No %s partition, sightings are not logged", HISTORY_PARTITION_LABEL);
+        return;
+    }
+    sector_total = history_part->size / HISTORY_SECTOR_SIZE;
+
+    /* Carry on after the newest sector so the ring keeps its order across boots. */
+    bool found = false;
+    cur_sector = sector_total - 1;
+    for (uint32_t i = 0; i < sector_total; i++) {
+        history_sector_t hdr;
+        if (esp_partition_read(history_part, i * HISTORY_SECTOR_SIZE, &hdr, sizeof(hdr)) != ESP_OK ||
+            hdr.magic != HISTORY_MAGIC) {
+            continue;
+        }
+        if (!found || (int32_t)(hdr.seq - next_seq) >= 0) {
+            next_seq = hdr.seq + 1;
+            cur_sector = i;
+            found = true;
+        }
+    }
+    boot_seq = next_seq;
+    ESP_LOGI(__FILE__, "History: %" PRIu32 " sectors of %u records, next seq %" PRIu32, sector_total,
+             (unsigned)HISTORY_RECS_PER_SECTOR, next_seq);
+}
+
+void history_log(const uint8_t *addr, uint8_t id, uint16_t name_hash, short rssi)
+{
+    unsigned head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&ring_tail, memory_order_acquire);
+    if (!history_part || head - tail == HISTORY_RING_LEN) {
+        stats.dropped++;
+        return;
+    }
+
+    history_rec_t *rec = &ring[head % HISTORY_RING_LEN];
+    uint32_t h = 2166136261u; // FNV-1a
+    for (int i = 0; i < 6; i++) {
+        h ^= addr[i];
+        h *= 16777619u;
+    }
+    rec->time_ms = esp_timer_get_time() / 1000;
+    rec->addr_hash = h;
+    rec->name_hash = name_hash;
+    rec->id = id;
+    rec->rssi = rssi < -128 ? -128 : rssi > 127 ? 127 : rssi;
+    atomic_store_explicit(&ring_head, head + 1, memory_order_release);
+    stats.logged++;
+
+    if (head + 1 - tail == HISTORY_RING_LEN / 2) {
+        xSemaphoreGive(flush_sem);
+    }
+}
+
+void history_flush()
+{
+    if (flush_sem) {
+        xSemaphoreGive(flush_sem);
+    }
+}
+
+void history_get_stats(history_stats_t *out)
+{
+    *out = stats;
+}
+
+/* Erase the sector after the current one and write its header. */
+static esp_err_t sector_open()
+{
+    uint32_t sector = (cur_sector + 1) % sector_total;
+    esp_err_t err = esp_partition_erase_range(history_part, sector * HISTORY_SECTOR_SIZE, HISTORY_SECTOR_SIZE);
+    if (err != ESP_OK) {
+        return err;
+    }
+    stats.erased++;
+
+    history_sector_t hdr = { .magic = HISTORY_MAGIC, .seq = next_seq, .boot = boot_seq, .count = 0xFFFFFFFF };
+    err = esp_partition_write(history_part, sector * HISTORY_SECTOR_SIZE, &hdr, sizeof(hdr));
+    if (err == ESP_OK) {
+        cur_sector = sector;
+        cur_count = 0;
+        next_seq++;
+    }
+    return err;
+}
+
+static void flush_ring()
+{
+    int64_t start = esp_timer_get_time();
+    unsigned tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&ring_head, memory_order_acquire);
+
+    while (tail != head) {
+        xSemaphoreTake(flash_lock, portMAX_DELAY);
+        esp_err_t err = ESP_OK;
+        if (cur_count == HISTORY_RECS_PER_SECTOR) {
+            err = sector_open();
+        }
+        /* Longest run that is contiguous in both the ring and the sector. */
+        uint32_t n = head - tail;
+        if (n > HISTORY_RING_LEN - tail % HISTORY_RING_LEN) {
+            n = HISTORY_RING_LEN - tail % HISTORY_RING_LEN;
+        }
+        if (n > HISTORY_RECS_PER_SECTOR - cur_count) {
+            n = HISTORY_RECS_PER_SECTOR - cur_count;
+        }
+        if (err == ESP_OK) {
+            size_t offset = cur_sector * HISTORY_SECTOR_SIZE + sizeof(history_sector_t) + cur_count * sizeof(history_rec_t);
+            err = esp_partition_write(history_part, offset, &ring[tail % HISTORY_RING_LEN], n * sizeof(history_rec_t));
+        }
+        xSemaphoreGive(flash_lock);
+        if (err != ESP_OK) {
+            ESP_LOGE(__FILE__, "History flush failed: %s", esp_err_to_name(err));
+            break;
+        }
+        cur_count += n;
+        tail += n;
+        stats.flushed += n;
+        atomic_store_explicit(&ring_tail, tail, memory_order_release);
+    }
+
+    uint32_t took_us = esp_timer_get_time() - start;
+    if (took_us > stats.flush_max_us) {
+        stats.flush_max_us = took_us;
+    }
+}
+
+void history_task(void *unused)
+{
+    if (!history_part) {
+        vTaskDelete(NULL);
+        return;
+    }
+    while (1) {
+        /* Woken early by history_log once the ring is half full. */
+        xSemaphoreTake(flush_sem, pdMS_TO_TICKS(HISTORY_FLUSH_MS));
+        flush_ring();
+    }
+}
+
+/* Records are appended in order, so the first erased one ends the sector. */
+static uint32_t sector_records(size_t base)
+{
+    uint32_t lo = 0, hi = HISTORY_RECS_PER_SECTOR;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        uint32_t time_ms;
+        size_t offset = base + sizeof(history_sector_t) + mid * sizeof(history_rec_t);
+        if (esp_partition_read(history_part, offset, &time_ms, sizeof(time_ms)) != ESP_OK || time_ms == 0xFFFFFFFF) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+esp_err_t history_export(history_emit_t emit, void *ctx, uint8_t *buf, size_t size)
+{
+    if (!history_part) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    size -= size % sizeof(history_rec_t);
+    if (size == 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    xSemaphoreTake(flash_lock, portMAX_DELAY);
+    uint32_t newest = cur_sector;
+    xSemaphoreGive(flash_lock);
+
+    /* The lock is held for a whole sector so it can't be erased halfway.
+     * Meanwhile only history_task waits, bt_task keeps filling the ring. */
+    esp_err_t err = ESP_OK;
+    for (uint32_t i = 1; err == ESP_OK && i <= sector_total; i++) {
+        size_t base = (newest + i) % sector_total * HISTORY_SECTOR_SIZE;
+        history_sector_t hdr;
+        xSemaphoreTake(flash_lock, portMAX_DELAY);
+        err = esp_partition_read(history_part, base, &hdr, sizeof(hdr));
+        if (err == ESP_OK && hdr.magic == HISTORY_MAGIC) {
+            hdr.count = sector_records(base);
+            err = emit(ctx, &hdr, sizeof(hdr));
+            for (uint32_t done = 0; err == ESP_OK && done < hdr.count;) {
+                size_t len = (hdr.count - done) * sizeof(history_rec_t);
+                if (len > size) {
+                    len = size;
+                }
+                err = esp_partition_read(history_part, base + sizeof(hdr) + done * sizeof(history_rec_t), buf, len);
+                if (err == ESP_OK) {
+                    err = emit(ctx, buf, len);
+                }
+                done += len / sizeof(history_rec_t);
+            }
+        }
+        xSemaphoreGive(flash_lock);
+    }
+    return err;
+}
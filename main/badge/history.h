@@ -0,0 +1,67 @@
+#ifndef __HISTORY_H__
+#define __HISTORY_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/*
+ * Log of nearby badge sightings for looking at who met whom after the
+ * event. bt_task appends records to a RAM ring without blocking and
+ * history_task writes them in batches to the "history" data partition,
+ * which is used as a ring of flash sectors: the oldest sector is erased
+ * when the log wraps.
+ */
+
+#define HISTORY_PARTITION_LABEL "history"
+#define HISTORY_PARTITION_SUBTYPE 0x40
+#define HISTORY_SECTOR_SIZE 4096
+#define HISTORY_MAGIC 0x48495331 // "HIS1"
+#define HISTORY_RING_LEN 256 // records buffered in RAM
+#define HISTORY_FLUSH_MS 30000 // longest a record waits in RAM
+#define HISTORY_SIGHTING_MS 60000 // a node in view is logged once per this
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t seq;   // increases by one for every sector written
+    uint32_t boot;  // seq of the first sector written since boot
+    uint32_t count; // erased on flash, the export fills in the records that follow
+} history_sector_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t time_ms;   // since boot, all ones marks the end of a sector
+    uint32_t addr_hash; // FNV-1a of the BD address
+    uint16_t name_hash;
+    uint8_t id;
+    int8_t rssi;        // smoothed, dBm
+} history_rec_t;
+
+#define HISTORY_RECS_PER_SECTOR ((HISTORY_SECTOR_SIZE - sizeof(history_sector_t)) / sizeof(history_rec_t))
+
+typedef struct {
+    uint32_t logged;   // records taken into the ring
+    uint32_t dropped;  // records lost to a full ring or a missing partition
+    uint32_t flushed;  // records written to flash
+    uint32_t erased;   // sectors erased
+    uint32_t flush_max_us; // longest flush, erase included
+} history_stats_t;
+
+void history_init();
+void history_task(void *unused);
+
+// Called by bt_task only, never blocks
+void history_log(const uint8_t *addr, uint8_t id, uint16_t name_hash, short rssi);
+// Wake history_task to write out the ring now
+void history_flush();
+void history_get_stats(history_stats_t *stats);
+
+/*
+ * Stream the log, oldest sector first, as a history_sector_t with `count`
+ * set followed by that many history_rec_t, for every sector in use. `buf`
+ * is the scratch space for reading flash. Stops at the first error `emit`
+ * returns.
+ */
+typedef esp_err_t (*history_emit_t)(void *ctx, const void *data, size_t len);
+esp_err_t history_export(history_emit_t emit, void *ctx, uint8_t *buf, size_t size);
+
+#endif
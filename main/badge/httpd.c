@@ -7,6 +7,16 @@ static rest_server_context_t *rest_context = NULL;
 static char* session_key = NULL;
 static int client_count = 0;
 
+/* Content hash of every file www-build.sh produced, as listed in etags.txt.
+ * Also tells which files have a .gz copy without touching SPIFFS. */
+typedef struct {
+    char path[32]; // as in the URI, SPIFFS names are at most 31 bytes
+    char etag[24]; // quoted, "crc-size" from cksum
+} www_etag_t;
+
+static www_etag_t *www_etags = NULL;
+static size_t www_etag_count = 0;
+
 static void reset_timer_callback(void* arg)
 {
 	esp_restart();
@@ -30,23 +40,119 @@ static esp_err_t set_content_type_from_file(httpd_req_t *req, const char *filepa
         type = "image/x-icon";
     } else if (CHECK_FILE_EXTENSION(filepath, ".svg")) {
         type = "image/svg+xml";
+    } else if (CHECK_FILE_EXTENSION(filepath, ".gif")) {
+        type = "image/gif";
+    } else if (CHECK_FILE_EXTENSION(filepath, ".mid")) {
+        type = "audio/midi";
     }
     return httpd_resp_set_type(req, type);
 }
 
+static void www_etags_load(void)
+{
+    FILE *fp = fopen(WWW_ETAGS_FILE, "r");
+    if (!fp) {
+        ESP_LOGW(REST_TAG, "No %s, web UI is sent without ETags", WWW_ETAGS_FILE);
+        return;
+    }
+    char line[80];
+    size_t lines = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        lines++;
+    }
+    www_etags = calloc(lines, sizeof(www_etag_t));
+    rewind(fp);
+
+    unsigned long crc, size;
+    while (www_etags && www_etag_count < lines && fgets(line, sizeof(line), fp)) {
+        www_etag_t *e = &www_etags[www_etag_count];
+        if (sscanf(line, "%lu %lu .%31s", &crc, &size, e->path) == 3) {
+            snprintf(e->etag, sizeof(e->etag), "\"%lx-%lx\"", crc, size);
+            www_etag_count++;
+        }
+    }
+    fclose(fp);
+    ESP_LOGI(REST_TAG, "%zu ETags loaded", www_etag_count);
+}
+
+static const www_etag_t *www_etag_find(const char *path, const char *suffix)
+{
+    size_t len = strlen(path);
+    for (size_t i = 0; i < www_etag_count; i++) {
+        const char *p = www_etags[i].path;
+        if (!strncmp(p, path, len) && !strcmp(p + len, suffix)) {
+            return &www_etags[i];
+        }
+    }
+    return NULL;
+}
+
+static bool etag_matches(httpd_req_t *req, const char *etag)
+{
+    char value[64];
+    esp_err_t err = httpd_req_get_hdr_value_str(req, "If-None-Match", value, sizeof(value));
+    return err == ESP_OK && strstr(value, etag);
+}
+
+static bool accepts_gzip(httpd_req_t *req)
+{
+    char value[64];
+    esp_err_t err = httpd_req_get_hdr_value_str(req, "Accept-Encoding", value, sizeof(value));
+    /* A truncated value still holds the start of the list, where gzip usually is. */
+    return (err == ESP_OK || err == ESP_ERR_HTTPD_RESULT_TRUNC) && strstr(value, "gzip");
+}
+
+static esp_err_t send_not_modified(httpd_req_t *req)
+{
+    httpd_resp_set_status(req, "304 Not Modified");
+    return httpd_resp_send(req, NULL, 0);
+}
+
 /* Send HTTP response with the contents of the requested file */
 static esp_err_t get_handler(httpd_req_t *req)
 {
     char filepath[FILE_PATH_MAX];
-    printf("free_heap_size = %lu\n", esp_get_free_heap_size());
-    rest_context = (rest_server_context_t *)req->user_ctx;
-    strlcpy(filepath, rest_context->base_path, sizeof(filepath));
+    rest_server_context_t *ctx = (rest_server_context_t *)req->user_ctx;
+    strlcpy(filepath, ctx->base_path, sizeof(filepath));
     if (req->uri[strlen(req->uri) - 1] == '/') {
         strlcat(filepath, "/index.html", sizeof(filepath));
     } else {
         strlcat(filepath, req->uri, sizeof(filepath));
     }
-    int fd = open(filepath, O_RDONLY, 0);
+    const char *uri_path = filepath + strlen(ctx->base_path);
+    bool accepts = accepts_gzip(req);
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+
+    /* Packed in the www partition: one send from mapped flash. */
+    www_file_t file;
+    if (www_find(uri_path, accepts, &file)) {
+        httpd_resp_set_hdr(req, "ETag", file.etag);
+        httpd_resp_set_hdr(req, "Cache-Control", WWW_CACHE_CONTROL);
+        if (etag_matches(req, file.etag)) {
+            return send_not_modified(req);
+        }
+        httpd_resp_set_type(req, file.type);
+        if (file.gzip) {
+            httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+        }
+        return httpd_resp_send(req, file.data, file.length);
+    }
+
+    /* Anything else comes from SPIFFS. www-build.sh stores a
+     * gzip copy next to the files it compresses well. With etags.txt loaded
+     * it says whether there is one, otherwise try it. */
+    bool gzip = accepts && strlen(filepath) + 3 < sizeof(filepath) &&
+                (!www_etag_count || www_etag_find(uri_path, ".gz"));
+    int fd = -1;
+    if (gzip) {
+        strcat(filepath, ".gz");
+        fd = open(filepath, O_RDONLY, 0);
+        filepath[strlen(filepath) - 3] = '\0';
+        gzip = fd != -1;
+    }
+    if (fd == -1) {
+        fd = open(filepath, O_RDONLY, 0);
+    }
     if (fd == -1) {
         ESP_LOGE(REST_TAG, "Failed to open file : %s", filepath);
         /* Respond with 500 Internal Server Error */
@@ -54,10 +160,23 @@ static esp_err_t get_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
+    /* The ETag of the file actually opened. */
+    const www_etag_t *etag = www_etag_find(uri_path, gzip ? ".gz" : "");
+    if (etag) {
+        httpd_resp_set_hdr(req, "ETag", etag->etag);
+        httpd_resp_set_hdr(req, "Cache-Control", WWW_CACHE_CONTROL);
+        if (etag_matches(req, etag->etag)) {
+            close(fd);
+            return send_not_modified(req);
+        }
+    }
+    if (gzip) {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    }
+
+    char *chunk = ctx->scratch;
     set_content_type_from_file(req, filepath);
-    printf("free_heap_size = %lu\n", esp_get_free_heap_size());
 
-    char *chunk = rest_context->scratch;
     ssize_t read_bytes;
     do {
         /* Read file in chunks into the scratch buffer */
@@ -73,7 +192,6 @@ static esp_err_t get_handler(httpd_req_t *req)
                 httpd_resp_sendstr_chunk(req, NULL);
                 /* Respond with 500 Internal Server Error */
                 httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to send file");
-                printf("free_heap_size = %lu\n", esp_get_free_heap_size());
                 return ESP_FAIL;
             }
         }
@@ -135,60 +253,74 @@ static bool check_session(httpd_req_t *req, const char* client_data) {
     return false;
 }
 
-static esp_err_t rest_send_response(httpd_req_t *req, char* response){
-    ESP_LOGI(__FILE__, "free_heap_size = %lu\n", esp_get_free_heap_size());
-    if (httpd_resp_sendstr(req, response) != ESP_OK) {
-        ESP_LOGE(__FILE__, "Response failed!");
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to send response");
-        ESP_LOGI(__FILE__, "free_heap_size = %lu\n", esp_get_free_heap_size());
-        return ESP_FAIL;
+static esp_err_t resp_send_chunk(void *ctx, const void *data, size_t len){
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
+}
+
+static json_writer_t *json_response_begin(httpd_req_t *req, json_response_t *res){
+    httpd_resp_set_type(req, "application/json");
+    json_init(&res->w, res->buf, sizeof(res->buf), resp_send_chunk, req);
+    json_object_begin(&res->w, NULL);
+    return &res->w;
+}
+
+/* A reply that fit the buffer goes out in one piece with its length, a
+ * longer one is already on its way in chunks. */
+static esp_err_t json_response_end(httpd_req_t *req, json_response_t *res){
+    json_writer_t *w = &res->w;
+    json_object_end(w);
+    esp_err_t err;
+    if (!w->flushed) {
+        err = w->err == ESP_OK ? httpd_resp_send(req, w->buf, w->len) : w->err;
+    } else if ((err = json_finish(w)) == ESP_OK) {
+        err = httpd_resp_send_chunk(req, NULL, 0);
     }
-    ESP_LOGI(__FILE__, "free_heap_size = %lu\n", esp_get_free_heap_size());
-    return ESP_OK;
+    if (err != ESP_OK) {
+        ESP_LOGE(__FILE__, "Response failed: %s", esp_err_to_name(err));
+    }
+    return err;
 }
 
 static esp_err_t system_info_handler(httpd_req_t *req)
 {
-    httpd_resp_set_type(req, "application/json");
-
-    cJSON *response = cJSON_CreateObject();
+    json_response_t res;
+    json_writer_t *w = json_response_begin(req, &res);
 
     esp_chip_info_t chip_info;
     esp_chip_info(&chip_info);
     
-    cJSON_AddStringToObject(response, "IDF version", IDF_VER);
-    cJSON_AddNumberToObject(response, "# cores", chip_info.cores);
-    cJSON_AddStringToObject(response, "firmware branch", GIT_BRANCH);
-    cJSON_AddStringToObject(response, "firmware commit", GIT_REV);
-    cJSON_AddStringToObject(response, "firmware tag", GIT_TAG);
+    json_string(w, "IDF version", IDF_VER);
+    json_int(w, "# cores", chip_info.cores);
+    json_string(w, "firmware branch", GIT_BRANCH);
+    json_string(w, "firmware commit", GIT_REV);
+    json_string(w, "firmware tag", GIT_TAG);
 
-    char* response_str = cJSON_PrintUnformatted(response);
-    
-    esp_err_t err = rest_send_response(req, response_str);
-
-    cJSON_free((void*)response_str);
-    cJSON_Delete(response);
-    return err;
+    return json_response_end(req, &res);
 }
 
+/* The file is JSON already, sent as it is read. */
 static esp_err_t schedule_handler(httpd_req_t *req){
-    httpd_resp_set_type(req, "application/json");
-    const char* buf = load_schedule_from_file();
-
-    if(!buf) {
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed on load_schedule_from_file()");
+    int fd = open(SCHEDULE_FILE, O_RDONLY, 0);
+    if(fd == -1) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to open " SCHEDULE_FILE);
         return ESP_FAIL;
     }
+    httpd_resp_set_type(req, "application/json");
 
-    esp_err_t err = rest_send_response(req, (char*)buf);
-    free((char*)buf);
+    char chunk[JSON_CHUNK_LEN];
+    ssize_t read_bytes;
+    esp_err_t err = ESP_OK;
+    while (err == ESP_OK && (read_bytes = read(fd, chunk, sizeof(chunk))) > 0) {
+        err = httpd_resp_send_chunk(req, chunk, read_bytes);
+    }
+    close(fd);
+    if (err == ESP_OK) {
+        err = httpd_resp_send_chunk(req, NULL, 0);
+    }
     return err;
 }
 
 static esp_err_t login_handler(httpd_req_t *req, const char* client_data){
-    httpd_resp_set_type(req, "application/json");
-
-    cJSON *response = cJSON_CreateObject();
     cJSON *client_json = cJSON_Parse(client_data);
     
     cJSON *client_pass = cJSON_GetObjectItem(client_json, "password");
@@ -199,12 +331,10 @@ static esp_err_t login_handler(httpd_req_t *req, const char* client_data){
     {
         session_init(req);
 
-        cJSON_AddStringToObject(response, "key", session_key);
-        char* response_str = cJSON_PrintUnformatted(response);
-
-        err = rest_send_response(req, response_str);
-
-        cJSON_free((void*)response_str);
+        json_response_t res;
+        json_writer_t *w = json_response_begin(req, &res);
+        json_string(w, "key", session_key);
+        err = json_response_end(req, &res);
     }
     else
     {
@@ -212,92 +342,92 @@ static esp_err_t login_handler(httpd_req_t *req, const char* client_data){
         err = ESP_FAIL;
     }
 
-    cJSON_Delete(response);
     cJSON_Delete(client_json);
     return err;
 }
 
-static esp_err_t logout_handler(httpd_req_t *req, const char* client_data){
-    httpd_resp_set_type(req, "application/json");
-
-    cJSON *response = cJSON_CreateObject();
+/* An empty object, for the commands that only say they went through. */
+static esp_err_t send_empty_response(httpd_req_t *req){
+    json_response_t res;
+    json_response_begin(req, &res);
+    return json_response_end(req, &res);
+}
 
-    esp_err_t err;
+static esp_err_t logout_handler(httpd_req_t *req, const char* client_data){
     if(check_session(req, client_data)){
         session_destroy();
-        
-        char* response_str = cJSON_PrintUnformatted(response);
-        
-        err = rest_send_response(req, response_str);
-
-        cJSON_free((void*)response_str);
+        return send_empty_response(req);
     }
-    else{
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed on logout_handler() function");
-        err = ESP_FAIL;
-    }
-
-    cJSON_Delete(response);
-    
-    return err;
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed on logout_handler() function");
+    return ESP_FAIL;
 }
 
 static esp_err_t check_auth_handler(httpd_req_t *req, const char* client_data){
-    httpd_resp_set_type(req, "application/json");
-
-    cJSON *response = cJSON_CreateObject();
-
-    esp_err_t err;
     if(check_session(req, client_data)){
-        char* response_str = cJSON_PrintUnformatted(response);
-        
-        err = rest_send_response(req, response_str);
-
-        cJSON_free((void*)response_str);
+        return send_empty_response(req);
     }
-    else{
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed on check_auth_handler() function");
-        err = ESP_FAIL;
-    }
-
-    cJSON_Delete(response);
-
-    return err;
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed on check_auth_handler() function");
+    return ESP_FAIL;
 }
 
 static esp_err_t radar_handler(httpd_req_t *req){
-    httpd_resp_set_type(req, "application/json");
-    cJSON *response = cJSON_CreateObject();
-    cJSON *radar = cJSON_AddArrayToObject(response, "radar");
-
-    char buf[BADGE_BUF_SIZE] = {0};
+    /* One consistent copy of the table, the reply may go out in several
+     * chunks while bt_task keeps publishing. Handlers run one at a time. */
+    static ble_radar_node_t nodes[MAX_NEARBY_NODE];
+    size_t count = ble_nodes_radar(nodes, MAX_NEARBY_NODE);
 
-    for (int i = 0; i < MAX_NEARBY_NODE; i++) {
-        if(!ble_nodes[i].active) continue;
+    json_response_t res;
+    json_writer_t *w = json_response_begin(req, &res);
 
-        cJSON *item = cJSON_CreateObject();
-        
-        //snprintf(buf, sizeof(buf), "%s", ble_nodes[i].name);
-        cJSON_AddStringToObject(item, "name", ble_nodes[i].name);
-        snprintf(buf, sizeof(buf), "%d dBm", ble_nodes[i].rssi);
-        cJSON_AddStringToObject(item, "rssi", buf);
-        snprintf(buf, sizeof(buf), "%d", ble_nodes[i].id);
-        cJSON_AddStringToObject(item, "id", buf);
-        cJSON_AddItemToArray(radar, item);
+    char buf[BADGE_BUF_SIZE] = {0};
+    json_array_begin(w, "radar");
+    for (size_t i = 0; i < count; i++) {
+        json_object_begin(w, NULL);
+        json_string(w, "name", nodes[i].name);
+        snprintf(buf, sizeof(buf), "%d dBm", nodes[i].rssi);
+        json_string(w, "rssi", buf);
+        snprintf(buf, sizeof(buf), "%d", nodes[i].id);
+        json_string(w, "id", buf);
+        json_object_end(w);
     }
+    json_array_end(w);
+
+    bt_scan_state_t scan;
+    bt_get_scan_state(&scan);
+    json_object_begin(w, "scan");
+    json_string(w, "profile", scan.profile);
+    json_bool(w, "active", scan.active);
+    json_fixed(w, "duty", scan.duty_permille, 1);
+    json_fixed(w, "current_ma", scan.est_current_ua, 3);
+    json_object_end(w);
+
+    return json_response_end(req, &res);
+}
 
-    char* response_str = cJSON_PrintUnformatted(response);
-    
-    esp_err_t err = rest_send_response(req, response_str);
-    cJSON_free((void*)response_str);
-    cJSON_Delete(response);
-    return err;
+static esp_err_t marauder_handler(httpd_req_t *req){
+    json_response_t res;
+    json_writer_t *w = json_response_begin(req, &res);
+
+    wifi_marauder_stats_t stats;
+    wifi_get_marauder_stats(&stats);
+    json_bool(w, "running", wifi_radio_get() == WIFI_RADIO_RAW_TX);
+    json_int(w, "frames", stats.frames);
+    json_int(w, "tx_ok", stats.tx_ok);
+    json_int(w, "tx_no_mem", stats.tx_no_mem);
+    json_int(w, "tx_failed", stats.tx_failed);
+    json_int(w, "overruns", stats.overruns);
+    json_int(w, "overrun_ms", stats.overrun_ms);
+    json_int(w, "overrun_max_ms", stats.overrun_max_ms);
+    json_int(w, "bursts", stats.bursts);
+    json_int(w, "wakeups", stats.wakeups);
+    json_int(w, "late_max_us", stats.late_max_us);
+    json_int(w, "busy_ms", stats.busy_ms);
+    json_int(w, "idle_ms", stats.idle_ms);
+
+    return json_response_end(req, &res);
 }
 
 static esp_err_t badge_name_handler(httpd_req_t *req, const char* client_data){
-    httpd_resp_set_type(req, "application/json");
-
-    cJSON *response = cJSON_CreateObject();
     cJSON *client_json = cJSON_Parse(client_data);
    
     esp_err_t err;
@@ -308,28 +438,22 @@ static esp_err_t badge_name_handler(httpd_req_t *req, const char* client_data){
                 badge_obj.update(3, name->valuestring);
             }
         }
-        cJSON_AddStringToObject(response, "name", badge_obj.device_name);
-        char* response_str = cJSON_PrintUnformatted(response);
-        
-        err = rest_send_response(req, response_str);
-
-        cJSON_free((void*)response_str);
+        json_response_t res;
+        json_writer_t *w = json_response_begin(req, &res);
+        json_string(w, "name", badge_obj.device_name);
+        err = json_response_end(req, &res);
     }
     else{
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed on badge_name_handler() function");
         err = ESP_FAIL;
     }
 
-    cJSON_Delete(response);
     cJSON_Delete(client_json);
 
     return err;
 }
 
 static esp_err_t wifi_handler(httpd_req_t *req, const char* client_data){
-    httpd_resp_set_type(req, "application/json");
-
-    cJSON *response = cJSON_CreateObject();
     cJSON *client_json = cJSON_Parse(client_data);
     
     esp_err_t err;
@@ -346,34 +470,25 @@ static esp_err_t wifi_handler(httpd_req_t *req, const char* client_data){
             } 
         }
         
-        cJSON *wifi_obj = cJSON_CreateObject();
-        cJSON_AddStringToObject(wifi_obj, "ssid", badge_obj.ap_ssid);
-        cJSON_AddStringToObject(wifi_obj, "password", badge_obj.ap_password);
-        cJSON_AddItemToObject(response, "wifi", wifi_obj);
-
-        char* response_str = cJSON_PrintUnformatted(response);
-        
-        err = rest_send_response(req, response_str);
-
-        cJSON_free((void*)response_str);
-        
+        json_response_t res;
+        json_writer_t *w = json_response_begin(req, &res);
+        json_object_begin(w, "wifi");
+        json_string(w, "ssid", badge_obj.ap_ssid);
+        json_string(w, "password", badge_obj.ap_password);
+        json_object_end(w);
+        err = json_response_end(req, &res);
     }
     else{
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed on wifi_handler() function");
         err = ESP_FAIL;
     }
 
-    cJSON_Delete(response);
     cJSON_Delete(client_json);
 
     return err;
 }
 
 static esp_err_t password_handler(httpd_req_t *req, const char* client_data){
-    httpd_resp_set_type(req, "application/json");
-
-    cJSON *response = cJSON_CreateObject();
-
     cJSON *client_json = cJSON_Parse(client_data);
 
     esp_err_t err;
@@ -382,35 +497,22 @@ static esp_err_t password_handler(httpd_req_t *req, const char* client_data){
         if(cJSON_IsString(password) && (password->valuestring != NULL) && (strlen(password->valuestring) > 0)) {
             badge_obj.update(0, password->valuestring);
         }
-        char* response_str = cJSON_PrintUnformatted(response);
-        
-        err = rest_send_response(req, response_str);
-
-        cJSON_free((void*)response_str);
+        err = send_empty_response(req);
     }
     else{
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed on password_handler() function");
         err = ESP_FAIL;
     }
 
-    cJSON_Delete(response);
     cJSON_Delete(client_json);
 
     return err;
 }
 
 static esp_err_t reset_handler(httpd_req_t *req, const char* client_data){
-    httpd_resp_set_type(req, "application/json");
-
-    cJSON *response = cJSON_CreateObject();
-
     esp_err_t err;
     if(check_session(req, client_data)){
-        char* response_str = cJSON_PrintUnformatted(response);
-
-        err = rest_send_response(req, response_str);
-
-        cJSON_free((void*)response_str);
+        err = send_empty_response(req);
 
         if(!unlink(SETTINGS_FILE)) {
             esp_timer_handle_t reset_timer;
@@ -427,24 +529,100 @@ static esp_err_t reset_handler(httpd_req_t *req, const char* client_data){
         err = ESP_FAIL;
     }
 
-    cJSON_Delete(response);
+    return err;
+}
+
+/* Streams the HCI capture, stopping it first so the file is complete. */
+static esp_err_t capture_download(httpd_req_t *req, char *scratch){
+    bt_capture_stop();
+    int fd = open(BT_CAPTURE_FILE, O_RDONLY, 0);
+    if(fd == -1) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "no capture");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"hci.cap\"");
+
+    ssize_t read_bytes;
+    esp_err_t err = ESP_OK;
+    while (err == ESP_OK && (read_bytes = read(fd, scratch, SCRATCH_BUFSIZE)) > 0) {
+        err = httpd_resp_send_chunk(req, scratch, read_bytes);
+    }
+    close(fd);
+    if (err == ESP_OK) {
+        err = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    return err;
+}
+
+static esp_err_t capture_handler(httpd_req_t *req, char* client_data){
+    cJSON *client_json = cJSON_Parse(client_data);
+
+    esp_err_t err;
+    if(check_session(req, client_data)){
+        cJSON* capture = cJSON_GetObjectItem(client_json, "capture");
+        if(cJSON_IsTrue(cJSON_GetObjectItem(client_json, "download"))) {
+            cJSON_Delete(client_json);
+            /* client_data is the request's scratch buffer and isn't needed any more. */
+            return capture_download(req, client_data);
+        }
+        if(cJSON_IsTrue(capture)) {
+            bt_capture_start(BT_CAPTURE_FILE, BT_CAPTURE_MAX_BYTES);
+        } else if(cJSON_IsFalse(capture)) {
+            bt_capture_stop();
+        }
+
+        uint32_t bytes;
+        json_response_t res;
+        json_writer_t *w = json_response_begin(req, &res);
+        json_bool(w, "capture", bt_capture_active(&bytes));
+        json_int(w, "bytes", bytes);
+        err = json_response_end(req, &res);
+    } else {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed on capture_handler() function");
+        err = ESP_FAIL;
+    }
+
+    cJSON_Delete(client_json);
 
     return err;
 }
 
+/* Streams the sighting log, see history_export() for the format. */
+static esp_err_t history_handler(httpd_req_t *req, char* client_data){
+    if(!check_session(req, client_data)){
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed on history_handler() function");
+        return ESP_FAIL;
+    }
+
+    history_flush();
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"history.bin\"");
+
+    /* client_data is the request's scratch buffer and isn't needed any more. */
+    esp_err_t err = history_export(resp_send_chunk, req, (uint8_t *)client_data, SCRATCH_BUFSIZE);
+    if (err != ESP_OK) {
+        ESP_LOGE(__FILE__, "History export failed: %s", esp_err_to_name(err));
+        httpd_resp_sendstr_chunk(req, NULL);
+        return err;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
 static esp_err_t post_handler(httpd_req_t *req)
 {
+    rest_server_context_t *ctx = (rest_server_context_t *)req->user_ctx;
     int total_len = req->content_len;
     int cur_len = 0;
-    char *buf = ((rest_server_context_t *)(req->user_ctx))->scratch;
     int received = 0;
     if (total_len >= SCRATCH_BUFSIZE) {
         /* Respond with 500 Internal Server Error */
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "content too long");
         return ESP_FAIL;
     }
+    char *buf = ctx->scratch;
     while (cur_len < total_len) {
-        received = httpd_req_recv(req, buf + cur_len, total_len);
+        received = httpd_req_recv(req, buf + cur_len, total_len - cur_len);
         if (received <= 0) {
             /* Respond with 500 Internal Server Error */
             httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to post control value");
@@ -471,6 +649,8 @@ static esp_err_t post_handler(httpd_req_t *req)
         system_info_handler(req);
     } else if (is_string_match(cmd, "radar")) {
         radar_handler(req);
+    } else if (is_string_match(cmd, "marauder")) {
+        marauder_handler(req);
     } else if (is_string_match(cmd, "name")) {
         badge_name_handler(req, buf);
     } else if (is_string_match(cmd, "wifi")) {
@@ -479,10 +659,14 @@ static esp_err_t post_handler(httpd_req_t *req)
         password_handler(req, buf);
     } else if (is_string_match(cmd, "reset")) {
         reset_handler(req, buf);
+    } else if (is_string_match(cmd, "capture")) {
+        capture_handler(req, buf);
+    } else if (is_string_match(cmd, "history")) {
+        history_handler(req, buf);
     } else {
         httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "not found");
     }
-    
+
     return ESP_OK;
 }
 
@@ -491,6 +675,9 @@ static httpd_handle_t start_webserver(void)
     httpd_handle_t server = NULL;
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.uri_match_fn = httpd_uri_match_wildcard;
+    config.max_open_sockets = HTTPD_MAX_SOCKETS;
+    /* Close the idlest keep-alive connection rather than refusing a new one. */
+    config.lru_purge_enable = true;
 
     // Start the httpd server
     ESP_LOGI(__FILE__, "Starting server on port: '%d'", config.server_port);
@@ -499,6 +686,9 @@ static httpd_handle_t start_webserver(void)
         rest_context = calloc(1, sizeof(rest_server_context_t));
         REST_CHECK(rest_context, "No memory for rest context", err);
         strlcpy(rest_context->base_path, BASE_PATH, sizeof(rest_context->base_path));
+        if (!www_etags) {
+            www_etags_load();
+        }
 
         // Registering the ws handler
         ESP_LOGI(__FILE__, "Registering URI handlers");
@@ -540,13 +730,13 @@ void connect_handler(void* arg, esp_event_base_t event_base,
     client_count++;
     ESP_LOGI(__FILE__, "Number of clients: %d", client_count);
 
-    ESP_LOGI(__FILE__, "free_heap_size = %lu\n", esp_get_free_heap_size());
+    ESP_LOGI(__FILE__, "free_heap_size = %" PRIu32 "\n", esp_get_free_heap_size());
     httpd_handle_t* server = (httpd_handle_t*) arg;
     if (*server == NULL) {
         ESP_LOGI(__FILE__, "Starting webserver");
         *server = start_webserver();
     }
-    ESP_LOGI(__FILE__, "free_heap_size = %lu\n", esp_get_free_heap_size());
+    ESP_LOGI(__FILE__, "free_heap_size = %" PRIu32 "\n", esp_get_free_heap_size());
 }
 
 void disconnect_handler(void* arg, esp_event_base_t event_base,
@@ -555,7 +745,7 @@ void disconnect_handler(void* arg, esp_event_base_t event_base,
     client_count--;
     ESP_LOGI(__FILE__, "Number of clients: %d", client_count);
 
-    ESP_LOGI(__FILE__, "free_heap_size = %lu\n", esp_get_free_heap_size());
+    ESP_LOGI(__FILE__, "free_heap_size = %" PRIu32 "\n", esp_get_free_heap_size());
     httpd_handle_t* server = (httpd_handle_t*) arg;
     if (*server && !client_count) {
         ESP_LOGI(__FILE__, "Stopping webserver");
@@ -565,7 +755,7 @@ void disconnect_handler(void* arg, esp_event_base_t event_base,
             ESP_LOGE(__FILE__, "Failed to stop http server");
         }
     }
-    ESP_LOGI(__FILE__, "free_heap_size = %lu\n", esp_get_free_heap_size());
+    ESP_LOGI(__FILE__, "free_heap_size = %" PRIu32 "\n", esp_get_free_heap_size());
 }
 
 
@@ -5,11 +5,13 @@
 #include <string.h>
 #include <string.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include "esp_http_server.h"
 #include "esp_system.h"
 #include "esp_log.h"
 #include "esp_vfs.h"
 #include "cJSON.h"
+#include "common/json_writer.h"
 
 #include "badge.h"
 
@@ -25,17 +27,32 @@
 
 #define FILE_PATH_MAX (ESP_VFS_PATH_MAX + 128)
 #define SCRATCH_BUFSIZE (2048)
+// A browser opens up to 6 connections for the page's assets. Leaves
+// room in CONFIG_LWIP_MAX_SOCKETS for the 3 the server keeps itself and
+// the sync client.
+#define HTTPD_MAX_SOCKETS 12
 #define BASE_PATH "/data/www"
+#define WWW_ETAGS_FILE BASE_PATH "/etags.txt" // written by www-build.sh
+// URLs carry no content hash, so every file is revalidated: a 304 when unchanged
+#define WWW_CACHE_CONTROL "no-cache"
 #define API_ENDPOINT "/api/v1/"
 #define API_ENDPOINT_WILDCARD "/api/v1/*"
 
 typedef struct rest_server_context {
     char base_path[ESP_VFS_PATH_MAX + 1];
-    char scratch[SCRATCH_BUFSIZE];
+    char scratch[SCRATCH_BUFSIZE]; // esp_http_server runs one handler at a time
 } rest_server_context_t;
 
 #define SESSION_KEY_LEN 8
 
+// REST replies are written into this much stack, longer ones go out in chunks
+#define JSON_CHUNK_LEN 512
+
+typedef struct {
+    json_writer_t w;
+    char buf[JSON_CHUNK_LEN];
+} json_response_t;
+
 void disconnect_handler(void* arg, esp_event_base_t event_base,
                                int32_t event_id, void* event_data);
 
@@ -1,3 +1,5 @@
+#include <inttypes.h>
+
 #include "led.h"
 #include "color.h"
 #include "hsv.h"
@@ -232,8 +234,12 @@ void set_easter_egg_active(bool active) {
 
 void led_task(void* arg) 
 {
+    /* One flash per period, only a completed set cuts the wait short:
+     * joins and leaves come all the time in a crowd. */
+    EventGroupHandle_t ble_events = ble_events_subscribe();
+
     while(1){
-        ESP_LOGI(__FILE__, "free_heap_size = %lu\n", esp_get_free_heap_size());
+        ESP_LOGD(__FILE__, "free_heap_size = %" PRIu32 "\n", esp_get_free_heap_size());
         
         // Skip normal LED operations if easter egg is active
         if(easter_egg_active) {
@@ -247,17 +253,25 @@ void led_task(void* arg)
         {
             ESP_LOGI(__FILE__, "Set found");
             set_completed();
-        } else {
-            uint8_t nearby_count = count_ble_nodes();
-            if(nearby_count > 0)
-            {
-                ESP_LOGI(__FILE__, "Badges around: %d", nearby_count);
-                flash(5000, 0xf0);
-            } else {
-                ESP_LOGI(__FILE__, "It is just me around");
-                flash(10000, 0xfa);
-            }
+            continue;
         }
 
+        int period;
+        uint16_t nearby_count = count_ble_nodes();
+        if(nearby_count > 0)
+        {
+            ESP_LOGI(__FILE__, "Badges around: %d", nearby_count);
+            flash(0, 0xf0);
+            period = 5000;
+        } else {
+            ESP_LOGI(__FILE__, "It is just me around");
+            flash(0, 0xfa);
+            period = 10000;
+        }
+        if(ble_events) {
+            xEventGroupWaitBits(ble_events, BLE_EVENT_SET_COMPLETE, pdTRUE, pdFALSE, pdMS_TO_TICKS(period));
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(period));
+        }
     }
 }
\ No newline at end of file
@@ -16,6 +16,12 @@ static bool sta_connected = false;
 
 static uint8_t admin_state = ADMIN_STATE_OFF;
 
+typedef struct {
+    wifi_radio_state_t state;
+    bool ok;
+} ui_wifi_done_t;
+static QueueHandle_t wifi_done_queue; // latest radio state from wifi_task
+
 static uint8_t up_button_press_counter = 0;
 static uint8_t down_button_press_counter = 0;
 static int8_t counter_screen = -1; // Initialize to invalid screen index
@@ -57,7 +63,47 @@ static bool ui_update_backlight(bool trigger)
 
 void ui_send_wifi_event(int event)
 {
-    xQueueSend(wifi_queue, &event, portMAX_DELAY);
+    wifi_request(event);
+}
+
+/* Called by wifi_task, the screen is updated from ui_task. */
+void ui_wifi_radio_done(int state, bool ok)
+{
+    ui_wifi_done_t done = { .state = state, .ok = ok };
+    if (wifi_done_queue) {
+        xQueueOverwrite(wifi_done_queue, &done);
+    }
+}
+
+/* The buttons switch admin_state right away, this settles it on what the
+ * radio actually did. */
+static void ui_wifi_apply(const ui_wifi_done_t *done)
+{
+    static const uint8_t admin_states[] = { ADMIN_STATE_OFF, ADMIN_STATE_AP, ADMIN_STATE_STA, ADMIN_STATE_MARAUDER };
+    admin_state = admin_states[done->state];
+    lv_obj_set_hidden(admin_switch_sta, admin_state == ADMIN_STATE_AP);
+    if (!done->ok) {
+        lv_label_set_text(admin_switch_sta_text, "WiFi failed!");
+    } else if (admin_state == ADMIN_STATE_OFF) {
+        lv_label_set_text(admin_switch_sta_text, "WIFI MARAUDER");
+    } else if (admin_state == ADMIN_STATE_MARAUDER) {
+        lv_label_set_text(admin_switch_sta_text, "Started...");
+    }
+}
+
+/* While the marauder runs its button shows the TX counters, once a second. */
+static void ui_marauder_refresh(void)
+{
+    static TickType_t last_refresh;
+    if (admin_state != ADMIN_STATE_MARAUDER || xTaskGetTickCount() - last_refresh < pdMS_TO_TICKS(1000)) {
+        return;
+    }
+    last_refresh = xTaskGetTickCount();
+
+    wifi_marauder_stats_t stats;
+    wifi_get_marauder_stats(&stats);
+    lv_label_set_text_fmt(admin_switch_sta_text, "TX %lu ERR %lu", (unsigned long)stats.tx_ok,
+                          (unsigned long)(stats.tx_no_mem + stats.tx_failed));
 }
 
 void scroll_up(lv_obj_t *screen){
@@ -166,7 +212,7 @@ void ui_button_down()
             switch(admin_state){
                 case ADMIN_STATE_OFF: // AP and STA disabled: enable STA
                     ui_send_wifi_event(EVENT_MARAUDER_START);
-                    lv_label_set_text(admin_switch_sta_text, "Started...");
+                    lv_label_set_text(admin_switch_sta_text, "Starting...");
                     admin_state = ADMIN_STATE_MARAUDER;
                     break;
                 case ADMIN_STATE_AP: // AP enabled: test showing IP labels
@@ -418,6 +464,7 @@ void ui_task(void *arg)
 {
     SemaphoreHandle_t xGuiSemaphore;
     xGuiSemaphore = xSemaphoreCreateMutex();
+    wifi_done_queue = xQueueCreate(1, sizeof(ui_wifi_done_t));
 
     lv_init();
     lvgl_driver_init();
@@ -453,6 +500,11 @@ void ui_task(void *arg)
         /* Try to take the semaphore, call lvgl related function on success */
         if (pdTRUE == xSemaphoreTake(xGuiSemaphore, portMAX_DELAY))
         {
+            ui_wifi_done_t done;
+            if (xQueueReceive(wifi_done_queue, &done, 0) == pdTRUE) {
+                ui_wifi_apply(&done);
+            }
+            ui_marauder_refresh();
             lv_task_handler();
             xSemaphoreGive(xGuiSemaphore);
         }
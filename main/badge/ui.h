@@ -51,6 +51,7 @@ void ui_force_show_ip_labels();
 void ui_list_all_netifs();
 void ui_toggle_sync();
 void ui_connection_progress(uint8_t cur, uint8_t max);
+void ui_wifi_radio_done(int state, bool ok); // a wifi_radio_state_t
 
 // void ui_button_up();
 // void ui_button_down();
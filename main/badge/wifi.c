@@ -1,11 +1,24 @@
+#include <inttypes.h>
+#include <stdatomic.h>
+
 #include "wifi.h"
 #include "esp_timer.h"
 #include "esp_random.h"
 #include "esp_wifi.h"
+#include "lib8tion.h"
 
 static const char *TAG = "WIFI";
-static wifi_mode_t curr_mode = WIFI_MODE_NULL;
-QueueHandle_t wifi_queue;
+/* State the UI asked for last. wifi_request() only updates it and wakes
+ * wifi_task, so bursts of requests collapse into the final one. */
+static atomic_int radio_target = WIFI_RADIO_OFF;
+static SemaphoreHandle_t wifi_wake;
+
+/* WiFi mode each radio state runs in: raw frames go out of the STA interface. */
+static const wifi_mode_t radio_modes[] = { WIFI_MODE_NULL, WIFI_MODE_AP, WIFI_MODE_STA, WIFI_MODE_STA };
+static const char *radio_names[] = { "off", "AP", "STA", "raw TX" };
+static wifi_radio_state_t radio_state = WIFI_RADIO_OFF;
+static wifi_radio_stats_t radio_stats; // written by wifi_task only
+static atomic_uint radio_requests; // wifi_request() runs on any task
 
 static EventGroupHandle_t wifi_event_group;
 const int CONNECTED_BIT = BIT0;
@@ -21,11 +34,31 @@ static char marauder_empty_ssid[32];
 static uint8_t marauder_channel_index = 0;
 static uint8_t marauder_mac_addr[6];
 static uint8_t marauder_wifi_channel = 1;
-static uint32_t marauder_packet_counter = 0;
-static uint32_t marauder_attack_time = 0;
-static uint32_t marauder_packet_rate_time = 0;
-static bool marauder_running = false;
+static volatile bool marauder_running = false;
 static TaskHandle_t marauder_task_handle = NULL;
+static SemaphoreHandle_t marauder_done; // given by the task as it ends
+static SemaphoreHandle_t marauder_wake; // given by marauder_timer and marauder_stop()
+static esp_timer_handle_t marauder_timer; // armed for the task's next deadline
+
+/* One beacon per SSID, built when the marauder starts. The TX loop only
+ * patches the address, sequence and timestamp fields in place. */
+static uint8_t marauder_frames[MARAUDER_SSID_COUNT][BEACON_MAX_LEN];
+static uint8_t marauder_frame_len[MARAUDER_SSID_COUNT]; // 0 skips the SSID
+static uint16_t marauder_seq;
+
+/* Written by the marauder task only, read from anywhere. */
+static atomic_uint marauder_frames_built;
+static atomic_uint marauder_tx_ok;
+static atomic_uint marauder_tx_no_mem;
+static atomic_uint marauder_tx_failed;
+static atomic_uint marauder_overruns;
+static atomic_uint marauder_overrun_ms;
+static atomic_uint marauder_overrun_max_ms;
+static atomic_uint marauder_bursts;
+static atomic_uint marauder_wakeups;
+static atomic_uint marauder_late_max_us;
+static atomic_uint marauder_busy_ms;
+static atomic_uint marauder_idle_ms;
 
 // SSID list for WiFi Marauder (stored in PROGMEM equivalent)
 // Multiple entries with slight variations to ensure WiFi scanners see them as separate networks
@@ -43,6 +76,15 @@ static const char* marauder_ssids[] = {
 };
 
 // WiFi Marauder helper functions
+static void marauder_set_channel_field(uint8_t channel) {
+    for (int i = 0; i < MARAUDER_SSID_COUNT; i++) {
+        if (marauder_frame_len[i]) {
+            // Last byte of the DS parameter set, right before the RSN element
+            marauder_frames[i][marauder_frame_len[i] - 27] = channel;
+        }
+    }
+}
+
 static void marauder_next_channel(void) {
     if (sizeof(marauder_channels) < 2) {
         return;
@@ -58,6 +100,7 @@ static void marauder_next_channel(void) {
     if (ch != marauder_wifi_channel && ch >= 1 && ch <= 14) {
         marauder_wifi_channel = ch;
         esp_wifi_set_channel(marauder_wifi_channel, WIFI_SECOND_CHAN_NONE);
+        marauder_set_channel_field(ch);
     }
 }
 
@@ -67,8 +110,8 @@ static void marauder_random_mac(void) {
     }
 }
 
-// Create a beacon frame dynamically for better control
-static int create_beacon_frame(uint8_t *frame, const uint8_t *mac, const char *ssid, uint8_t channel) {
+// Build a beacon template, the timestamp is left at 0
+static int create_beacon_frame(uint8_t *frame, const uint8_t *mac, const char *ssid, uint8_t ssid_len, uint8_t channel) {
     int offset = 0;
     
     // Frame Control (0-1)
@@ -100,10 +143,8 @@ static int create_beacon_frame(uint8_t *frame, const uint8_t *mac, const char *s
     frame[offset++] = 0x00;
     
     // Timestamp (24-31)
-    uint64_t timestamp = esp_timer_get_time() / 1000; // Convert to microseconds
-    for (int i = 0; i < 8; i++) {
-        frame[offset++] = (timestamp >> (i * 8)) & 0xFF;
-    }
+    memset(&frame[offset], 0, 8);
+    offset += 8;
     
     // Beacon Interval (32-33)
     frame[offset++] = 0x64; // 100 TU = 100ms
@@ -115,9 +156,9 @@ static int create_beacon_frame(uint8_t *frame, const uint8_t *mac, const char *s
     
     // SSID Parameter Set (36-37 + SSID)
     frame[offset++] = 0x00; // SSID parameter tag
-    frame[offset++] = strlen(ssid); // SSID length
-    memcpy(&frame[offset], ssid, strlen(ssid));
-    offset += strlen(ssid);
+    frame[offset++] = ssid_len; // SSID length
+    memcpy(&frame[offset], ssid, ssid_len);
+    offset += ssid_len;
     
     // Supported Rates (38 + rates)
     frame[offset++] = 0x01; // Supported Rates parameter tag
@@ -165,6 +206,48 @@ static int create_beacon_frame(uint8_t *frame, const uint8_t *mac, const char *s
     return offset;
 }
 
+void wifi_marauder_build_frames(uint8_t channel) {
+    for (int i = 0; i < MARAUDER_SSID_COUNT; i++) {
+        const char* ssid = marauder_ssids[i];
+        size_t ssid_len = ssid ? strlen(ssid) : 0;
+        marauder_frame_len[i] = 0;
+        if (ssid == NULL) {
+            ESP_LOGW(TAG, "Invalid SSID at index %d", i);
+        } else if (ssid_len > 32) {
+            ESP_LOGW(TAG, "SSID too long at index %d: %d", i, (int)ssid_len);
+        } else {
+            marauder_frame_len[i] = create_beacon_frame(marauder_frames[i], marauder_mac_addr, ssid, ssid_len, channel);
+        }
+    }
+    // Addresses come from the lib8tion generator, seed it once per start
+    random16_add_entropy(esp_random());
+}
+
+int wifi_marauder_frame(int index, int64_t tsf_us, const uint8_t **frame) {
+    uint8_t *f = marauder_frames[index];
+    *frame = f;
+    if (!marauder_frame_len[index]) {
+        return 0;
+    }
+
+    // Completely different MAC address for each frame, so WiFi scanners
+    // see them as different devices. Unicast and globally unique.
+    for (int i = 0; i < 6; i++) {
+        f[BEACON_SA_OFFSET + i] = random8();
+    }
+    f[BEACON_SA_OFFSET] &= 0xFC;
+    memcpy(&f[BEACON_BSSID_OFFSET], &f[BEACON_SA_OFFSET], 6);
+
+    uint16_t seq_ctrl = (marauder_seq++ & 0x0FFF) << 4;
+    f[BEACON_SEQ_OFFSET] = seq_ctrl & 0xFF;
+    f[BEACON_SEQ_OFFSET + 1] = seq_ctrl >> 8;
+
+    for (int i = 0; i < 8; i++) {
+        f[BEACON_TIMESTAMP_OFFSET + i] = (uint64_t)tsf_us >> (i * 8);
+    }
+    return marauder_frame_len[index];
+}
+
 static void marauder_init_ssids(void) {
     // Initialize empty SSID with spaces
     for (int i = 0; i < 32; i++) {
@@ -173,14 +256,21 @@ static void marauder_init_ssids(void) {
     
     // Generate random MAC address
     marauder_random_mac();
+    wifi_marauder_build_frames(marauder_channels[0]);
     
     ESP_LOGI(TAG, "WiFi Marauder initialized with %d SSIDs", MARAUDER_SSID_COUNT);
 }
 
+static void marauder_timer_callback(void* arg)
+{
+	xSemaphoreGive(marauder_wake);
+}
+
 static void inactivity_timer_callback(void* arg)
 {
 	if(!ap_clients_num){
-		stop_wifi();
+		/* Runs in the esp_timer task, the radio belongs to wifi_task. */
+		wifi_request(EVENT_HOTSPOT_STOP);
 	} else {
 		ESP_LOGE(__FILE__, "Timer should not be running...");
 	}
@@ -203,6 +293,9 @@ static void event_handler(void* arg, esp_event_base_t event_base,
 		if(ap_clients_num < 0) ap_clients_num = 0;
 		if(!ap_clients_num) esp_timer_start_once(inactivity_timer, AP_INACTIVITY_TIMEOUT_S * 1000000);
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        if (radio_state != WIFI_RADIO_STA) {
+            return; // left STA on purpose
+        }
         if (retry_num < STA_MAXIMUM_RETRY) {
 			ui_connection_progress(retry_num+1, STA_MAXIMUM_RETRY);
             esp_wifi_connect();
@@ -234,6 +327,7 @@ void wifi_init(void)
 	assert(ap_netif);
 	esp_netif_t *sta_netif = esp_netif_create_default_wifi_sta();
 	assert(sta_netif);
+	(void)ap_netif; (void)sta_netif; // NDEBUG builds drop the asserts
 	wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
 	ESP_ERROR_CHECK( esp_wifi_init(&cfg) );
 	ESP_ERROR_CHECK( esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &event_handler, NULL) );
@@ -243,19 +337,32 @@ void wifi_init(void)
 	// ESP_ERROR_CHECK( esp_event_handler_register(IP_EVENT, IP_EVENT_AP_STAIPASSIGNED, &event_handler, NULL) );
 
 
+	const esp_timer_create_args_t timer_args = {
+		.callback = &inactivity_timer_callback,
+		.name = "inactivity-timer"
+	};
+	ESP_ERROR_CHECK(esp_timer_create(&timer_args, &inactivity_timer));
+	const esp_timer_create_args_t marauder_timer_args = {
+		.callback = &marauder_timer_callback,
+		.name = "marauder-timer"
+	};
+	ESP_ERROR_CHECK(esp_timer_create(&marauder_timer_args, &marauder_timer));
+	marauder_done = xSemaphoreCreateBinary();
+	marauder_wake = xSemaphoreCreateBinary();
+	wifi_wake = xSemaphoreCreateBinary();
+
+	/* The driver stays started from here on, see wifi_radio_set(). */
 	ESP_ERROR_CHECK( esp_wifi_set_storage(WIFI_STORAGE_RAM) );
 	ESP_ERROR_CHECK( esp_wifi_set_mode(WIFI_MODE_NULL) );
 	ESP_ERROR_CHECK( esp_wifi_start() );
 
-    curr_mode = WIFI_MODE_NULL;
+    radio_state = WIFI_RADIO_OFF;
 
 	initialized = true;
 }
 
-bool start_wifi_ap(void)
+static void ap_configure(void)
 {
-	ESP_LOGI(__FILE__, "free_heap_size = %lu\n", esp_get_free_heap_size());
-	
 	const char* AP_WIFI_SSID = badge_obj.ap_ssid;
 	const char* AP_WIFI_PASSWORD = badge_obj.ap_password;
 	
@@ -270,107 +377,40 @@ bool start_wifi_ap(void)
 		wifi_config.ap.authmode = WIFI_AUTH_OPEN;
 	}
 
-
-	ESP_ERROR_CHECK( esp_wifi_set_mode(WIFI_MODE_AP) );
 	ESP_ERROR_CHECK( esp_wifi_set_config(ESP_IF_WIFI_AP, &wifi_config) );
-	ESP_ERROR_CHECK( esp_wifi_start() );
 	ESP_ERROR_CHECK( esp_wifi_set_inactive_time(WIFI_IF_AP, AP_INACTIVITY_TIMEOUT_S) );
 
-	const esp_timer_create_args_t timer_args = {
-		.callback = &inactivity_timer_callback,
-		.name = "inactivity-timer"
-	};
-
-	ESP_ERROR_CHECK(esp_timer_create(&timer_args, &inactivity_timer));
-
 	ESP_LOGI(TAG, "WIFI_MODE_AP started. SSID:%s password:%s",
 			 AP_WIFI_SSID, AP_WIFI_PASSWORD);
-
-    curr_mode = WIFI_MODE_AP;
-	ESP_LOGI(__FILE__, "free_heap_size = %lu\n", esp_get_free_heap_size());
-
-	return ESP_OK;
-}
-
-void stop_wifi(){
-	ESP_LOGI(__FILE__, "free_heap_size = %lu\n", esp_get_free_heap_size());
-
-    esp_wifi_disconnect();
-    esp_wifi_stop();
-    esp_wifi_set_mode(WIFI_MODE_NULL);
-    ESP_LOGI(TAG, "WIFI disabled");
-	ESP_LOGI(__FILE__, "free_heap_size = %lu\n", esp_get_free_heap_size());
 }
 
-void wifi_task(void *arg)
-{   
-    wifi_queue = xQueueCreate(4, sizeof(uint32_t));
-    uint32_t wifi_event;
-
-    while (1) {
-        if(!xQueueReceive(wifi_queue, &wifi_event, portMAX_DELAY))
-            continue;
-        
-        switch (wifi_event) {
-            case EVENT_HOTSPOT_START:
-                stop_wifi();
-                start_wifi_ap();
-				esp_timer_start_once(inactivity_timer, AP_INACTIVITY_TIMEOUT_S * 1000000);
-                break;
-			case EVENT_MARAUDER_START:
-                stop_wifi();
-                start_wifi_marauder();
-                break;
-            case EVENT_HOTSPOT_STOP:
-                stop_wifi();
-				esp_timer_stop(inactivity_timer);
-                break;    
-			case EVENT_MARAUDER_STOP:
-				stop_wifi_marauder();
-				break;           
-            default:
-                ESP_LOGI(__FILE__, "not exists event 0x%04" PRIx32, wifi_event);
-                break;
-        }
-        vTaskDelay( 1000 / portTICK_PERIOD_MS );
-    }
+static bool sta_connect(void)
+{
+	wifi_config_t wifi_config = { 0 };
+	snprintf((char*)wifi_config.sta.ssid, SIZEOF(wifi_config.sta.ssid), "%s", badge_obj.sta_ssid);
+	snprintf((char*)wifi_config.sta.password, SIZEOF(wifi_config.sta.password), "%s", badge_obj.sta_password);
+	ESP_ERROR_CHECK( esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_config) );
+
+	retry_num = 0;
+	xEventGroupClearBits(wifi_event_group, CONNECTED_BIT | FAIL_BIT);
+	ESP_LOGI(TAG, "WIFI_MODE_STA connecting to %s", badge_obj.sta_ssid);
+	return esp_wifi_connect() == ESP_OK;
 }
 
-// WiFi Marauder functions
-bool start_wifi_marauder(void)
+static bool marauder_start(void)
 {
     ESP_LOGI(TAG, "Starting WiFi Marauder...");
-    
-    if (marauder_running) {
-        ESP_LOGW(TAG, "WiFi Marauder already running");
-        return true;
-    }
-    
-    // Stop any existing WiFi
-    stop_wifi();
-    
-    // Initialize WiFi Marauder
     marauder_init_ssids();
-    
-    // Initialize WiFi with proper configuration for raw packet transmission
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    cfg.nvs_enable = 0; // Disable NVS for this operation
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-    
-    // Set WiFi mode to NULL first, then to STA
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_NULL));
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_channel(marauder_channels[0], WIFI_SECOND_CHAN_NONE));
-    
-    // Enable promiscuous mode for raw packet transmission
+
+    // Raw frames go out of the STA interface, on a fixed channel
+    marauder_channel_index = 0;
+    marauder_wifi_channel = marauder_channels[0];
+    ESP_ERROR_CHECK(esp_wifi_set_channel(marauder_wifi_channel, WIFI_SECOND_CHAN_NONE));
     ESP_ERROR_CHECK(esp_wifi_set_promiscuous(true));
-    
-    ESP_ERROR_CHECK(esp_wifi_start());
-    
-    // Wait a bit for WiFi to stabilize
-    vTaskDelay(pdMS_TO_TICKS(100));
-    
-    // Create the marauder task
+
+    xSemaphoreTake(marauder_done, 0); // from a task that ended on its own
+    xSemaphoreTake(marauder_wake, 0);
+    marauder_running = true;
     BaseType_t ret = xTaskCreate(
         wifi_marauder_task,
         "wifi_marauder",
@@ -382,140 +422,297 @@ bool start_wifi_marauder(void)
     
     if (ret != pdPASS) {
         ESP_LOGE(TAG, "Failed to create WiFi Marauder task");
-        esp_wifi_stop();
-        esp_wifi_deinit();
+        marauder_running = false;
+        esp_wifi_set_promiscuous(false);
         return false;
     }
     
-    marauder_running = true;
-    curr_mode = WIFI_MODE_STA;
-    
     ESP_LOGI(TAG, "WiFi Marauder started successfully");
     return true;
 }
 
-void stop_wifi_marauder(void)
+static void marauder_stop(void)
 {
     ESP_LOGI(TAG, "Stopping WiFi Marauder...");
-    
-    if (!marauder_running) {
-        ESP_LOGW(TAG, "WiFi Marauder not running");
-        return;
-    }
-    
     marauder_running = false;
-    
-    // Delete the marauder task
-    if (marauder_task_handle != NULL) {
-        vTaskDelete(marauder_task_handle);
-        marauder_task_handle = NULL;
+    xSemaphoreGive(marauder_wake);
+
+    // Let the task finish the frame in flight rather than deleting it mid-call.
+    // Keep waiting past the timeout: a second task must not start beside it.
+    if (xSemaphoreTake(marauder_done, pdMS_TO_TICKS(MARAUDER_STOP_TIMEOUT_MS)) != pdTRUE) {
+        ESP_LOGW(TAG, "WiFi Marauder task did not end in %d ms, still waiting", MARAUDER_STOP_TIMEOUT_MS);
+        xSemaphoreTake(marauder_done, portMAX_DELAY);
     }
-    
-    // Disable promiscuous mode
+    marauder_task_handle = NULL;
+
     esp_wifi_set_promiscuous(false);
-    
-    // Stop WiFi
-    esp_wifi_stop();
-    esp_wifi_set_mode(WIFI_MODE_NULL);
-    esp_wifi_deinit();
-    
-    curr_mode = WIFI_MODE_NULL;
     ESP_LOGI(TAG, "WiFi Marauder stopped");
 }
 
+static void radio_leave(wifi_radio_state_t state)
+{
+	switch (state) {
+		case WIFI_RADIO_AP:
+			esp_timer_stop(inactivity_timer);
+			ap_clients_num = 0;
+			break;
+		case WIFI_RADIO_STA:
+			esp_wifi_disconnect();
+			break;
+		case WIFI_RADIO_RAW_TX:
+			marauder_stop();
+			break;
+		default:
+			break;
+	}
+}
+
+static bool radio_enter(wifi_radio_state_t state)
+{
+	switch (state) {
+		case WIFI_RADIO_AP:
+			ap_configure();
+			esp_timer_start_once(inactivity_timer, AP_INACTIVITY_TIMEOUT_S * 1000000);
+			return true;
+		case WIFI_RADIO_STA:
+			return sta_connect();
+		case WIFI_RADIO_RAW_TX:
+			return marauder_start();
+		default:
+			return true;
+	}
+}
+
+bool wifi_radio_set(wifi_radio_state_t state)
+{
+	if (state == radio_state) {
+		return true;
+	}
+	ESP_LOGI(__FILE__, "free_heap_size = %" PRIu32 "\n", esp_get_free_heap_size());
+	int64_t start = esp_timer_get_time();
+	wifi_radio_state_t from = radio_state;
+
+	/* Set first, the event handler and marauder task act on it while leaving. */
+	radio_state = state;
+	radio_leave(from);
+	if (radio_modes[state] != radio_modes[from]) {
+		ESP_ERROR_CHECK( esp_wifi_set_mode(radio_modes[state]) );
+	}
+	bool ok = radio_enter(state);
+	if (!ok) {
+		radio_state = WIFI_RADIO_OFF;
+		esp_wifi_set_mode(WIFI_MODE_NULL);
+	}
+
+	uint32_t took_us = esp_timer_get_time() - start;
+	radio_stats.switches++;
+	radio_stats.last_us = took_us;
+	radio_stats.total_us += took_us;
+	if (took_us > radio_stats.max_us) {
+		radio_stats.max_us = took_us;
+	}
+	ESP_LOGI(TAG, "Radio %s -> %s%s in %" PRIu32 " us", radio_names[from], radio_names[radio_state],
+			 ok ? "" : " (failed)", took_us);
+	ESP_LOGI(__FILE__, "free_heap_size = %" PRIu32 "\n", esp_get_free_heap_size());
+	return ok;
+}
+
+wifi_radio_state_t wifi_radio_get(void)
+{
+	return radio_state;
+}
+
+void wifi_get_radio_stats(wifi_radio_stats_t *stats)
+{
+	*stats = radio_stats;
+	stats->requests = atomic_load(&radio_requests);
+}
+
+/* Target after `event`: a stop only applies to the mode it names. */
+static int event_target(uint32_t event, int target)
+{
+    switch (event) {
+        case EVENT_HOTSPOT_START: return WIFI_RADIO_AP;
+        case EVENT_MARAUDER_START: return WIFI_RADIO_RAW_TX;
+        case EVENT_STA_START: return WIFI_RADIO_STA;
+        case EVENT_HOTSPOT_STOP: return target == WIFI_RADIO_AP ? WIFI_RADIO_OFF : target;
+        case EVENT_MARAUDER_STOP: return target == WIFI_RADIO_RAW_TX ? WIFI_RADIO_OFF : target;
+        case EVENT_STA_STOP: return target == WIFI_RADIO_STA ? WIFI_RADIO_OFF : target;
+        default:
+            ESP_LOGI(__FILE__, "not exists event 0x%04" PRIx32, event);
+            return target;
+    }
+}
+
+void wifi_request(uint32_t event)
+{
+    int target = atomic_load(&radio_target);
+    int next;
+    do {
+        next = event_target(event, target);
+    } while (next != target && !atomic_compare_exchange_weak(&radio_target, &target, next));
+
+    atomic_fetch_add(&radio_requests, 1);
+    if (wifi_wake) {
+        xSemaphoreGive(wifi_wake);
+    }
+}
+
+void wifi_task(void *arg)
+{   
+    while (1) {
+        xSemaphoreTake(wifi_wake, portMAX_DELAY);
+
+        /* Apply the latest target until no newer request came in meanwhile. */
+        bool ok = true;
+        int target;
+        while ((target = atomic_load(&radio_target)) != radio_state) {
+            ok = wifi_radio_set(target);
+            if (!ok) {
+                // Drop the failed target, unless it was replaced already
+                atomic_compare_exchange_strong(&radio_target, &target, radio_state);
+            }
+        }
+        ui_wifi_radio_done(radio_state, ok);
+    }
+}
+
+void wifi_get_marauder_stats(wifi_marauder_stats_t *stats)
+{
+    stats->frames = atomic_load(&marauder_frames_built);
+    stats->tx_ok = atomic_load(&marauder_tx_ok);
+    stats->tx_no_mem = atomic_load(&marauder_tx_no_mem);
+    stats->tx_failed = atomic_load(&marauder_tx_failed);
+    stats->overruns = atomic_load(&marauder_overruns);
+    stats->overrun_ms = atomic_load(&marauder_overrun_ms);
+    stats->overrun_max_ms = atomic_load(&marauder_overrun_max_ms);
+    stats->bursts = atomic_load(&marauder_bursts);
+    stats->wakeups = atomic_load(&marauder_wakeups);
+    stats->late_max_us = atomic_load(&marauder_late_max_us);
+    stats->busy_ms = atomic_load(&marauder_busy_ms);
+    stats->idle_ms = atomic_load(&marauder_idle_ms);
+}
+
+static void marauder_log_summary(wifi_marauder_stats_t *last)
+{
+    wifi_marauder_stats_t now;
+    wifi_get_marauder_stats(&now);
+    uint32_t busy = now.busy_ms - last->busy_ms, idle = now.idle_ms - last->idle_ms;
+    ESP_LOGI(TAG, "WiFi Marauder: %" PRIu32 " sent, %" PRIu32 " no mem, %" PRIu32 " failed, %" PRIu32 " overruns, %" PRIu32
+             "%% idle on channel %d",
+             now.tx_ok - last->tx_ok, now.tx_no_mem - last->tx_no_mem, now.tx_failed - last->tx_failed,
+             now.overruns - last->overruns, busy + idle ? idle * 100 / (busy + idle) : 100, marauder_wifi_channel);
+    *last = now;
+}
+
+static void marauder_burst(int64_t now_us)
+{
+    // Send beacon frames for each SSID on current channel
+    for (int ssid_index = 0; ssid_index < MARAUDER_SSID_COUNT && marauder_running; ssid_index++) {
+        const uint8_t *beacon_frame;
+        int frame_len = wifi_marauder_frame(ssid_index, now_us, &beacon_frame);
+        if (!frame_len) {
+            continue;
+        }
+        atomic_fetch_add(&marauder_frames_built, 1);
+
+        esp_err_t ret = esp_wifi_80211_tx(ESP_IF_WIFI_STA, beacon_frame, frame_len, 0);
+        if (ret == ESP_OK) {
+            atomic_fetch_add(&marauder_tx_ok, 1);
+        } else if (ret == ESP_ERR_NO_MEM) {
+            // The driver is out of buffers, the rest waits for the next burst
+            atomic_fetch_add(&marauder_tx_no_mem, 1);
+            break;
+        } else {
+            atomic_fetch_add(&marauder_tx_failed, 1);
+        }
+    }
+    atomic_fetch_add(&marauder_bursts, 1);
+}
+
+/*
+ * Bursts, channel changes and summaries each have a deadline on a fixed
+ * grid, so the period doesn't drift with the time spent sending. The task
+ * arms marauder_timer for the earliest deadline and sleeps until it fires.
+ */
 void wifi_marauder_task(void *arg)
 {
     ESP_LOGI(TAG, "WiFi Marauder task started");
     
-    // Reset counters
-    marauder_packet_counter = 0;
-    marauder_attack_time = 0;
-    marauder_packet_rate_time = 0;
-    
+    // Counters run since boot, the summary shows what changed in between
+    wifi_marauder_stats_t last_summary;
+    wifi_get_marauder_stats(&last_summary);
+
+    int64_t now_us = esp_timer_get_time();
+    int64_t next_burst = now_us;
+    int64_t next_channel = now_us + MARAUDER_CHANNEL_INTERVAL_MS * 1000LL;
+    int64_t next_summary = now_us + MARAUDER_PACKET_RATE_INTERVAL_MS * 1000LL;
+    int64_t busy_us = 0, idle_us = 0;
+
     while (marauder_running) {
-        uint32_t current_time = esp_timer_get_time() / 1000; // Convert to milliseconds
-        
-        // Send out SSIDs every 100ms (faster for better AP visibility)
-        if (current_time - marauder_attack_time > 100) {
-            marauder_attack_time = current_time;
-            
-            // Check if WiFi is still running
-            if (curr_mode != WIFI_MODE_STA) {
-                ESP_LOGW(TAG, "WiFi mode changed, stopping marauder task");
-                break;
+        // Check if WiFi is still running
+        if (radio_state != WIFI_RADIO_RAW_TX) {
+            ESP_LOGW(TAG, "WiFi mode changed, stopping marauder task");
+            break;
+        }
+
+        if (now_us >= next_burst) {
+            uint32_t late_us = now_us - next_burst;
+            if (late_us > atomic_load(&marauder_late_max_us)) {
+                atomic_store(&marauder_late_max_us, late_us);
             }
-            
-            // Send beacon frames for each SSID on current channel
-            for (int ssid_index = 0; ssid_index < MARAUDER_SSID_COUNT; ssid_index++) {
-                if (!marauder_running) break;
-                
-                const char* ssid = marauder_ssids[ssid_index];
-                if (ssid == NULL) {
-                    ESP_LOGW(TAG, "Invalid SSID at index %d", ssid_index);
-                    continue;
-                }
-                
-                uint8_t ssid_len = strlen(ssid);
-                if (ssid_len > 32) {
-                    ESP_LOGW(TAG, "SSID too long at index %d: %d", ssid_index, ssid_len);
-                    continue;
-                }
-                
-                // Generate completely different MAC address for each SSID
-                // This ensures WiFi scanners see them as different devices
-                uint8_t unique_mac[6];
-                for (int i = 0; i < 6; i++) {
-                    unique_mac[i] = esp_random() % 256;
+            marauder_burst(next_burst);
+
+            // Skip the slots a slow burst ran into rather than sending them back to back
+            int64_t period_us = MARAUDER_BEACON_INTERVAL_MS * 1000LL;
+            next_burst += period_us;
+            int64_t end_us = esp_timer_get_time();
+            if (end_us >= next_burst) {
+                uint32_t over = (end_us - next_burst) / 1000;
+                atomic_fetch_add(&marauder_overruns, 1);
+                atomic_fetch_add(&marauder_overrun_ms, over);
+                if (over > atomic_load(&marauder_overrun_max_ms)) {
+                    atomic_store(&marauder_overrun_max_ms, over);
                 }
-                // Ensure the first bit is 0 (unicast) and second bit is 0 (globally unique)
-                unique_mac[0] &= 0xFC;
-                
-                // Create beacon frame dynamically
-                uint8_t beacon_frame[256]; // Increased buffer size for dynamic frames
-                int frame_len = create_beacon_frame(beacon_frame, unique_mac, ssid, marauder_wifi_channel);
-                
-                // Debug: Log beacon frame details
-                ESP_LOGI(TAG, "Beacon frame: SSID='%s' (len=%d), MAC="MACSTR", Channel=%d, FrameLen=%d", 
-                         ssid, ssid_len, MAC2STR(unique_mac), marauder_wifi_channel, frame_len);
-                
-                // Send packet once per SSID to reduce memory pressure
-                esp_err_t ret = esp_wifi_80211_tx(ESP_IF_WIFI_STA, beacon_frame, frame_len, 0);
-                if (ret == ESP_OK) {
-                    marauder_packet_counter++;
-                    ESP_LOGI(TAG, "Sent beacon for SSID %d: %s with MAC "MACSTR" on channel %d", 
-                             ssid_index, ssid, MAC2STR(unique_mac), marauder_wifi_channel);
-                } else {
-                    ESP_LOGW(TAG, "Failed to send beacon packet: %s", esp_err_to_name(ret));
-                    // If we get memory errors, wait a bit longer
-                    if (ret == ESP_ERR_NO_MEM) {
-                        vTaskDelay(pdMS_TO_TICKS(50));
-                    }
-                }
-                
-                // Very small delay between SSIDs to make them appear simultaneously
-                vTaskDelay(pdMS_TO_TICKS(1));
-            }
-            
-            // Change channel every 2 seconds (slower channel switching for better AP detection)
-            static uint32_t last_channel_change = 0;
-            if (current_time - last_channel_change > 2000) {
-                marauder_next_channel();
-                last_channel_change = current_time;
-                ESP_LOGI(TAG, "WiFi Marauder switched to channel %d", marauder_wifi_channel);
+                next_burst += ((end_us - next_burst) / period_us + 1) * period_us;
             }
         }
-        
+
+        // Change channel every 2 seconds (slower channel switching for better AP detection)
+        if (now_us >= next_channel) {
+            marauder_next_channel();
+            next_channel += MARAUDER_CHANNEL_INTERVAL_MS * 1000LL;
+            ESP_LOGD(TAG, "WiFi Marauder switched to channel %d", marauder_wifi_channel);
+        }
+
         // Show packet rate every 5 seconds
-        if (current_time - marauder_packet_rate_time > MARAUDER_PACKET_RATE_INTERVAL_MS) {
-            marauder_packet_rate_time = current_time;
-            
-            ESP_LOGI(TAG, "WiFi Marauder: %lu packets sent", marauder_packet_counter);
-            marauder_packet_counter = 0;
+        if (now_us >= next_summary) {
+            next_summary += MARAUDER_PACKET_RATE_INTERVAL_MS * 1000LL;
+            marauder_log_summary(&last_summary);
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(20)); // Reduced delay for more responsive AP announcements
+
+        int64_t next = next_burst;
+        if (next_channel < next) next = next_channel;
+        if (next_summary < next) next = next_summary;
+
+        int64_t sleep_start = esp_timer_get_time();
+        busy_us += sleep_start - now_us;
+        if (next > sleep_start && esp_timer_start_once(marauder_timer, next - sleep_start) == ESP_OK) {
+            xSemaphoreTake(marauder_wake, portMAX_DELAY);
+            esp_timer_stop(marauder_timer); // when woken by marauder_stop()
+        }
+        now_us = esp_timer_get_time();
+        idle_us += now_us - sleep_start;
+
+        atomic_fetch_add(&marauder_wakeups, 1);
+        atomic_store(&marauder_busy_ms, atomic_load(&marauder_busy_ms) + busy_us / 1000);
+        atomic_store(&marauder_idle_ms, atomic_load(&marauder_idle_ms) + idle_us / 1000);
+        busy_us %= 1000;
+        idle_us %= 1000;
     }
     
+    marauder_log_summary(&last_summary);
     ESP_LOGI(TAG, "WiFi Marauder task ended");
+    xSemaphoreGive(marauder_done);
     vTaskDelete(NULL);
-}
\ No newline at end of file
+}
@@ -20,18 +20,76 @@
 #define MARAUDER_SSID_COUNT 10
 #define MARAUDER_CHANNEL_COUNT 3
 #define MARAUDER_BEACON_INTERVAL_MS 100
+#define MARAUDER_CHANNEL_INTERVAL_MS 2000
 #define MARAUDER_PACKET_RATE_INTERVAL_MS 5000
+#define MARAUDER_STOP_TIMEOUT_MS 500
+
+/* Beacon layout, see create_beacon_frame(). The fields patched for every
+ * transmission sit at fixed offsets, the SSID starts at BEACON_SSID_OFFSET. */
+#define BEACON_SA_OFFSET 10
+#define BEACON_BSSID_OFFSET 16
+#define BEACON_SEQ_OFFSET 22
+#define BEACON_TIMESTAMP_OFFSET 24
+#define BEACON_SSID_OFFSET 38
+#define BEACON_TAIL_LEN 39 // rates, DS parameter set and RSN after the SSID
+#define BEACON_MAX_LEN (BEACON_SSID_OFFSET + 32 + BEACON_TAIL_LEN)
+
+/*
+ * The driver is initialised and started once by wifi_init(). Moving between
+ * these states only changes the mode, configuration and promiscuous setting
+ * where they differ.
+ */
+typedef enum {
+    WIFI_RADIO_OFF,    // WIFI_MODE_NULL
+    WIFI_RADIO_AP,     // admin hotspot
+    WIFI_RADIO_STA,    // connected to badge_obj.sta_ssid
+    WIFI_RADIO_RAW_TX, // marauder beacons
+} wifi_radio_state_t;
+
+typedef struct {
+    uint32_t requests; // wifi_request() calls
+    uint32_t switches;
+    uint32_t last_us;  // duration of the last switch
+    uint32_t max_us;
+    uint64_t total_us;
+} wifi_radio_stats_t;
 
 void wifi_init(void);
 
-bool start_wifi_ap(void);
+// Ask wifi_task for the state an EVENT_* leads to. Never blocks; the UI
+// hears back through ui_wifi_radio_done() once the radio has settled.
+void wifi_request(uint32_t event);
+
+// Only called from wifi_task
+bool wifi_radio_set(wifi_radio_state_t state);
+wifi_radio_state_t wifi_radio_get(void);
+void wifi_get_radio_stats(wifi_radio_stats_t *stats);
+
+typedef struct {
+    uint32_t frames;         // beacons prepared for sending
+    uint32_t tx_ok;
+    uint32_t tx_no_mem;      // ESP_ERR_NO_MEM, the driver ran out of buffers
+    uint32_t tx_failed;      // any other error
+    uint32_t overruns;       // bursts longer than MARAUDER_BEACON_INTERVAL_MS
+    uint32_t overrun_ms;     // time spent past the interval, in total
+    uint32_t overrun_max_ms;
+    uint32_t bursts;
+    uint32_t wakeups;        // times the task woke up
+    uint32_t late_max_us;    // worst burst start past its deadline
+    uint32_t busy_ms;        // task running, in total
+    uint32_t idle_ms;        // task asleep until the next deadline
+} wifi_marauder_stats_t;
 
-// WiFi Marauder functions
-bool start_wifi_marauder(void);
-void stop_wifi_marauder(void);
 void wifi_marauder_task(void *arg);
+// Counted since boot, across marauder runs
+void wifi_get_marauder_stats(wifi_marauder_stats_t *stats);
 
-void stop_wifi(void);
+// Build the beacons for every marauder SSID, done by marauder_start()
+void wifi_marauder_build_frames(uint8_t channel);
+// Patch the beacon of SSID `index` for its next transmission: a new random
+// address, the next sequence number and `tsf_us`. Returns its length, 0 if
+// the SSID was skipped.
+int wifi_marauder_frame(int index, int64_t tsf_us, const uint8_t **frame);
 
 void wifi_task(void *);
 
@@ -0,0 +1,110 @@
+#include <inttypes.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_partition.h"
+
+#include "www.h"
+
+static const char *blob = NULL;
+static const www_entry_t *entries = NULL;
+static uint32_t entry_count = 0;
+static spi_flash_mmap_handle_t blob_handle;
+
+static uint32_t path_hash(const char *path)
+{
+    uint32_t h = 2166136261u; // FNV-1a, as www-pack.js
+    while (*path) {
+        h ^= (uint8_t)*path++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Offsets are checked here once, lookups trust them. */
+static bool string_valid(uint32_t offset, uint32_t size)
+{
+    return offset < size && memchr(blob + offset, '\0', size - offset);
+}
+
+static bool entries_valid(uint32_t size)
+{
+    for (uint32_t i = 0; i < entry_count; i++) {
+        const www_entry_t *e = &entries[i];
+        if (!string_valid(e->path, size) || !string_valid(e->type, size) || !string_valid(e->etag, size) ||
+            e->offset > size || e->length > size - e->offset || (i && e->hash < entries[i - 1].hash)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void www_init(void)
+{
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, WWW_PARTITION_SUBTYPE,
+                                                           WWW_PARTITION_LABEL);
+    if (!part) {
+        ESP_LOGW(__FILE__, "No %s partition, web UI is sent from SPIFFS", WWW_PARTITION_LABEL);
+        return;
+    }
+    www_header_t hdr;
+    /* The blob has to hold the header and the entry table before anything
+     * is taken from it; sizes are checked without overflowing. */
+    if (esp_partition_read(part, 0, &hdr, sizeof(hdr)) != ESP_OK || hdr.magic != WWW_MAGIC ||
+        hdr.size < sizeof(hdr) || hdr.count > (hdr.size - sizeof(hdr)) / sizeof(www_entry_t) ||
+        hdr.size > part->size) {
+        ESP_LOGW(__FILE__, "Nothing packed in the %s partition, web UI is sent from SPIFFS", WWW_PARTITION_LABEL);
+        return;
+    }
+
+    const void *ptr;
+    esp_err_t err = esp_partition_mmap(part, 0, hdr.size, SPI_FLASH_MMAP_DATA, &ptr, &blob_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(__FILE__, "Mapping the %s partition failed: %s", WWW_PARTITION_LABEL, esp_err_to_name(err));
+        return;
+    }
+    blob = ptr;
+    entries = (const www_entry_t *)(blob + sizeof(hdr));
+    entry_count = hdr.count;
+    if (!entries_valid(hdr.size)) {
+        ESP_LOGE(__FILE__, "Corrupt %s partition, web UI is sent from SPIFFS", WWW_PARTITION_LABEL);
+        spi_flash_munmap(blob_handle);
+        blob = NULL;
+        entry_count = 0;
+        return;
+    }
+    ESP_LOGI(__FILE__, "Web UI: %" PRIu32 " files, %" PRIu32 " bytes mapped", hdr.count, hdr.size);
+}
+
+bool www_find(const char *path, bool gzip, www_file_t *file)
+{
+    uint32_t h = path_hash(path);
+    uint32_t lo = 0, hi = entry_count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (entries[mid].hash < h) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    /* The plain file sorts before its gzip copy. */
+    const www_entry_t *found = NULL;
+    for (uint32_t i = lo; i < entry_count && entries[i].hash == h; i++) {
+        const www_entry_t *e = &entries[i];
+        if (strcmp(blob + e->path, path) || ((e->flags & WWW_GZIP) && !gzip)) {
+            continue;
+        }
+        found = e;
+    }
+    if (!found) {
+        return false;
+    }
+    file->data = blob + found->offset;
+    file->length = found->length;
+    file->type = blob + found->type;
+    file->etag = blob + found->etag;
+    file->gzip = found->flags & WWW_GZIP;
+    return true;
+}
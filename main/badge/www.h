@@ -0,0 +1,55 @@
+#ifndef __WWW_H__
+#define __WWW_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * The web UI packed by www-pack.js into the "www" data partition. The
+ * partition is mapped into the address space once and get_handler sends
+ * files straight from flash, without opening anything on SPIFFS. Files
+ * not in the blob (or all of them, if the partition was never written)
+ * are still served from BASE_PATH.
+ *
+ * Layout: a header, the entries sorted by path hash, the strings they
+ * point to and then the file contents, each 4-byte aligned. Offsets are
+ * from the start of the blob.
+ */
+
+#define WWW_PARTITION_LABEL "www"
+#define WWW_PARTITION_SUBTYPE 0x41
+#define WWW_MAGIC 0x31575757 // "WWW1"
+#define WWW_GZIP 0x01
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t count; // entries
+    uint32_t size;  // whole blob
+    uint32_t reserved;
+} www_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t hash;   // FNV-1a of the path, gzip copies share it
+    uint32_t path;   // "/index.html"
+    uint32_t type;   // Content-Type
+    uint32_t etag;   // quoted, same as etags.txt gives the SPIFFS file
+    uint32_t flags;  // WWW_GZIP
+    uint32_t offset; // contents
+    uint32_t length;
+} www_entry_t;
+
+typedef struct {
+    const char *data; // mapped flash
+    size_t length;
+    const char *type;
+    const char *etag;
+    bool gzip;
+} www_file_t;
+
+// Maps the partition, once at boot
+void www_init(void);
+// Looks `path` up, the gzip copy if there is one and `gzip` allows it
+bool www_find(const char *path, bool gzip, www_file_t *file);
+
+#endif
@@ -1,3 +1,4 @@
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -5,12 +6,15 @@
 
 void app_main() 
 {
-    ESP_LOGI(__FILE__, "MAIN START: free_heap_size = %lu\n", esp_get_free_heap_size());
+    ESP_LOGI(__FILE__, "MAIN START: free_heap_size = %" PRIu32 "\n", esp_get_free_heap_size());
 
     badge_init();
     led_init();
+    www_init();
     
-    // start bluetooth
+    // start bluetooth, sightings are logged to flash by history_task
+    history_init();
+    xTaskCreatePinnedToCore(history_task, "history_task", 3072, NULL, 2, NULL, 0);
     bt_init();
     xTaskCreatePinnedToCore(bt_task, "bt_task", 4096, NULL, 6, NULL, 0);
 
@@ -30,6 +34,6 @@ void app_main()
     ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_AP_STAIPASSIGNED, &connect_handler, &server));
     ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_AP_STADISCONNECTED, &disconnect_handler, &server));
 
-    ESP_LOGI(__FILE__, "MAIN END: free_heap_size = %lu\n", esp_get_free_heap_size());
+    ESP_LOGI(__FILE__, "MAIN END: free_heap_size = %" PRIu32 "\n", esp_get_free_heap_size());
 }
 
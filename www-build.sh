@@ -37,4 +37,29 @@ else
 		sed -i'' 's:/backend/:/api/v1/:g' "$WORK_DIR/js/client.js"
 fi
 
-cp -r $WORK_DIR/* "$DIR/../data/www/"
+# gzip copies that get_handler sends to browsers accepting them, kept only
+# where they are smaller. SPIFFS names are at most 31 bytes, a file whose
+# .gz name would be longer is sent uncompressed.
+find "$WORK_DIR" -type f \( -name '*.html' -o -name '*.js' -o -name '*.css' -o -name '*.svg' -o -name '*.mid' \) | while read -r f; do
+  name="/www${f#$WORK_DIR}.gz"
+  if [ ${#name} -gt 31 ]; then
+    echo "Not compressing $name: name too long for SPIFFS"
+    continue
+  fi
+  gzip -9 -n -c "$f" > "$f.gz"
+  if [ $(wc -c < "$f.gz") -ge $(wc -c < "$f") ]; then
+    rm "$f.gz"
+  fi
+done
+
+# Content hashes for the ETags get_handler sends, read once at start.
+(cd "$WORK_DIR" && find . -type f ! -name etags.txt | LC_ALL=C sort | xargs cksum > etags.txt)
+
+# data/www only holds build output: start it over, so the .gz copy and ETag
+# of a file renamed or deleted in public/ aren't stored and packed again.
+rm -rf "$WWW_DIR"
+mkdir -p "$WWW_DIR"
+cp -r $WORK_DIR/* "$WWW_DIR/"
+
+# One blob of the same files for the www partition, see www-pack.js.
+node www-pack.js "$WWW_DIR" www.bin
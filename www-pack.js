@@ -0,0 +1,111 @@
+#!/usr/bin/env node
+// Packs the web UI built by www-build.sh into one blob for the "www" flash
+// partition, which get_handler sends from without going through SPIFFS.
+// The layout is described in main/badge/www.h.
+//
+//   node www-pack.js data/www www.bin
+//
+// The ETags come from etags.txt so they match what the SPIFFS copy sends.
+
+const fs = require('fs');
+const path = require('path');
+
+const MAGIC = 0x31575757; // "WWW1"
+const HEADER_LEN = 16;
+const ENTRY_LEN = 28;
+const GZIP = 1;
+const PARTITION_SIZE = 256 * 1024; // partitions.csv
+
+const TYPES = {
+  '.html': 'text/html',
+  '.js': 'application/javascript',
+  '.css': 'text/css',
+  '.png': 'image/png',
+  '.ico': 'image/x-icon',
+  '.svg': 'image/svg+xml',
+  '.gif': 'image/gif',
+  '.mid': 'audio/midi',
+};
+
+function fnv1a(str) {
+  let h = 2166136261;
+  for (const b of Buffer.from(str)) {
+    h ^= b;
+    h = Math.imul(h, 16777619) >>> 0;
+  }
+  return h;
+}
+
+const [dir, out] = process.argv.slice(2);
+if (!dir || !out) {
+  console.error('usage: node www-pack.js <www dir> <blob>');
+  process.exit(2);
+}
+
+const entries = [];
+for (const line of fs.readFileSync(path.join(dir, 'etags.txt'), 'utf8').split('\n')) {
+  const m = line.match(/^(\d+) (\d+) \.(\/.*)$/);
+  if (!m) {
+    continue;
+  }
+  const file = m[3];
+  const gzip = file.endsWith('.gz');
+  const uri = gzip ? file.slice(0, -3) : file;
+  entries.push({
+    uri,
+    gzip,
+    data: fs.readFileSync(path.join(dir, file)),
+    type: TYPES[path.extname(uri).toLowerCase()] || 'text/plain',
+    etag: `"${Number(m[1]).toString(16)}-${Number(m[2]).toString(16)}"`,
+    hash: fnv1a(uri),
+  });
+}
+entries.sort((a, b) => a.hash - b.hash || a.gzip - b.gzip);
+
+// Strings are shared between entries, every offset is from the blob start.
+const strings = new Map();
+let stringsLen = 0;
+const stringsStart = HEADER_LEN + entries.length * ENTRY_LEN;
+function string(s) {
+  if (!strings.has(s)) {
+    strings.set(s, stringsStart + stringsLen);
+    stringsLen += Buffer.byteLength(s) + 1;
+  }
+  return strings.get(s);
+}
+for (const e of entries) {
+  e.pathOff = string(e.uri);
+  e.typeOff = string(e.type);
+  e.etagOff = string(e.etag);
+}
+
+let size = (stringsStart + stringsLen + 3) & ~3;
+for (const e of entries) {
+  e.offset = size;
+  size = (size + e.data.length + 3) & ~3;
+}
+if (size > PARTITION_SIZE) {
+  console.error(`${size} bytes do not fit the ${PARTITION_SIZE} byte www partition`);
+  process.exit(1);
+}
+
+const blob = Buffer.alloc(size);
+blob.writeUInt32LE(MAGIC, 0);
+blob.writeUInt32LE(entries.length, 4);
+blob.writeUInt32LE(size, 8);
+entries.forEach((e, i) => {
+  const o = HEADER_LEN + i * ENTRY_LEN;
+  blob.writeUInt32LE(e.hash, o);
+  blob.writeUInt32LE(e.pathOff, o + 4);
+  blob.writeUInt32LE(e.typeOff, o + 8);
+  blob.writeUInt32LE(e.etagOff, o + 12);
+  blob.writeUInt32LE(e.gzip ? GZIP : 0, o + 16);
+  blob.writeUInt32LE(e.offset, o + 20);
+  blob.writeUInt32LE(e.data.length, o + 24);
+  e.data.copy(blob, e.offset);
+});
+for (const [s, off] of strings) {
+  blob.write(s + '\0', off);
+}
+fs.writeFileSync(out, blob);
+console.log(`${out}: ${entries.length} entries, ${size} bytes`);